@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+##
+ # @file  fontgen.py
+ # @brief Generate the packed proportional font from the 8x8 font bitmap
+ #
+ # @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ # @copyright Agilack (c) 2022
+ #
+ # @page License
+ # Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ # modify it under the terms of the GNU Lesser General Public License
+ # version 3 as published by the Free Software Foundation. You should
+ # have received a copy of the GNU Lesser General Public License along
+ # with this program, see LICENSE.md file for more details.
+ # This program is distributed WITHOUT ANY WARRANTY.
+##
+#
+# Usage: fontgen.py <display_font.h> <output.h>
+#
+# Each glyph of the 8x8 font is trimmed (empty columns on the left and right
+# are removed) and all glyphs are packed into one array of columns. An index
+# gives, for each glyph, the offset of its first column (bits 15:4) and its
+# width (bits 3:0). Glyphs without any pixel (space) have a width of zero.
+#
+import re
+import sys
+
+def load(path):
+    glyphs = []
+    for line in open(path):
+        m = re.match(r'\s*\{([^}]*)\}', line)
+        if not m:
+            continue
+        cols = [int(v, 16) for v in m.group(1).split(',')]
+        if len(cols) != 8:
+            sys.exit("fontgen: invalid glyph: " + line.strip())
+        glyphs.append(cols)
+    if len(glyphs) != 96:
+        sys.exit("fontgen: expected 96 glyphs, found %d" % len(glyphs))
+    return glyphs
+
+def pack(glyphs):
+    data = []
+    index = []
+    for cols in glyphs:
+        used = [i for i, c in enumerate(cols) if c]
+        if not used:
+            index.append(0)
+            continue
+        cols = cols[used[0]:used[-1] + 1]
+        # Reuse an identical sequence of columns if already packed
+        pos = find(data, cols)
+        if pos < 0:
+            pos = len(data)
+            data.extend(cols)
+        index.append((pos << 4) | len(cols))
+    if len(data) > 0xFFF:
+        sys.exit("fontgen: too many columns (%d)" % len(data))
+    return index, data
+
+def find(data, cols):
+    n = len(cols)
+    for i in range(len(data) - n + 1):
+        if data[i:i + n] == cols:
+            return i
+    return -1
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("Usage: fontgen.py <display_font.h> <output.h>")
+    index, data = pack(load(sys.argv[1]))
+
+    out = []
+    out.append("/* Generated by scripts/fontgen.py from %s, do not edit */"
+               % sys.argv[1].split('/')[-1])
+    out.append("#ifndef FONT_PROP_H")
+    out.append("#define FONT_PROP_H")
+    out.append("")
+    out.append("/* Size of the font : %d bytes */" % (len(index) * 2 + len(data)))
+    out.append("")
+    out.append("/* For each glyph: offset into font_cols (bits 15:4), width (bits 3:0) */")
+    out.append("static const unsigned short font_idx[96] = {")
+    for i in range(0, 96, 8):
+        out.append("    " + ", ".join("0x%04X" % v for v in index[i:i + 8]) +
+                   ", /* 0x%02X */" % (0x20 + i))
+    out.append("};")
+    out.append("")
+    out.append("static const unsigned char font_cols[%d] = {" % len(data))
+    for i in range(0, len(data), 12):
+        out.append("    " + ", ".join("0x%02X" % v for v in data[i:i + 12]) + ",")
+    out.append("};")
+    out.append("#endif")
+    out.append("/* EOF */")
+    open(sys.argv[2], "w").write("\n".join(out) + "\n")
+
+if __name__ == "__main__":
+    main()
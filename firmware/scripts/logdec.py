@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+##
+ # @file  logdec.py
+ # @brief Decode tokenized log records sent by the firmware on debug UART
+ #
+ # @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ # @copyright Agilack (c) 2022
+ #
+ # @page License
+ # Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ # modify it under the terms of the GNU Lesser General Public License
+ # version 3 as published by the Free Software Foundation. You should
+ # have received a copy of the GNU Lesser General Public License along
+ # with this program, see LICENSE.md file for more details.
+ # This program is distributed WITHOUT ANY WARRANTY.
+##
+#
+# Usage: logdec.py <firmware.elf> [capture]
+#
+# The capture (or stdin) is the raw byte stream of the debug UART. Normal text
+# is copied as is, log records (see src/log.c) are replaced by the message
+# rebuilt from the format string found into the ".logstr" section of the ELF.
+#
+import re
+import struct
+import sys
+
+LEVELS = ["LOST", "ERR ", "WARN", "INFO", "DBG "]
+SOF = 0xFE
+
+def load_logstr(path):
+    elf = open(path, "rb").read()
+    if elf[0:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit("logdec: %s is not an ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+    sections = []
+    for i in range(shnum):
+        sh = struct.unpack_from("<IIIIIIIIII", elf, shoff + i * shentsize)
+        sections.append(sh)
+    names = sections[shstrndx][4]
+    for sh in sections:
+        end = elf.index(b"\0", names + sh[0])
+        if elf[names + sh[0]:end] == b".logstr":
+            return sh[3], elf[sh[4]:sh[4] + sh[5]]
+    sys.exit("logdec: no .logstr section into %s" % path)
+
+def signed(v):
+    return v - (1 << 32) if v & 0x80000000 else v
+
+def convert(m, arg):
+    flags, width, prec, conv = m.group(1), m.group(2), m.group(3), m.group(4)
+    if conv == "d" or conv == "i":
+        s = "%d" % signed(arg)
+    elif conv == "u":
+        s = "%d" % arg
+    elif conv == "x":
+        s = "%x" % arg
+    elif conv == "X":
+        s = "%X" % arg
+    elif conv == "c":
+        s = chr(arg & 0xFF)
+    elif conv == "q":
+        p = min(int(prec), 4) if prec is not None else 2
+        s = "%.*f" % (p, signed(arg) / 65536.0)
+    else:
+        s = "?"
+    w = int(width) if width else 0
+    if "-" in flags:
+        return s.ljust(w)
+    if "0" in flags and conv != "c":
+        neg = s.startswith("-")
+        return ("-" if neg else "") + s.lstrip("-").rjust(w - neg, "0")
+    return s.rjust(w)
+
+def format_msg(fmt, args):
+    args = list(args)
+    def repl(m):
+        if m.group(4) == "%":
+            return "%"
+        return convert(m, args.pop(0) if args else 0)
+    return re.sub(r"%([-0]*)(\d*)(?:\.(\d+))?l?([cdiuxXq%])", repl, fmt)
+
+def decode(addr, strings, hdr, ts, args):
+    level = (hdr >> 4) & 0x0F
+    if level == 0:
+        return "[%10d] LOST %d record(s)" % (ts, args[0])
+    off = (hdr >> 8) - addr
+    if off < 0 or off >= len(strings):
+        return "[%10d] ???? unknown format 0x%06X" % (ts, hdr >> 8)
+    fmt = strings[off:strings.index(b"\0", off)].decode("ascii", "replace")
+    name = LEVELS[level] if level < len(LEVELS) else "L%d  " % level
+    return "[%10d] %s %s" % (ts, name, format_msg(fmt, args))
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: logdec.py <firmware.elf> [capture]")
+    addr, strings = load_logstr(sys.argv[1])
+    src = open(sys.argv[2], "rb") if len(sys.argv) > 2 else sys.stdin.buffer
+    out = sys.stdout
+    while True:
+        c = src.read(1)
+        if not c:
+            break
+        if c[0] != SOF:
+            out.write(c.decode("latin-1"))
+            continue
+        n = src.read(1)
+        if not n or n[0] < 2:
+            continue
+        data = src.read(n[0] * 4)
+        if len(data) < n[0] * 4:
+            break
+        words = struct.unpack("<%dI" % n[0], data)
+        out.write("\n" + decode(addr, strings, words[0], words[1], words[2:]) + "\n")
+        out.flush()
+
+if __name__ == "__main__":
+    main()
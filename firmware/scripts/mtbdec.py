@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+##
+ # @file  mtbdec.py
+ # @brief Decode a Micro Trace Buffer dump sent by the firmware on debug UART
+ #
+ # @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ # @copyright Agilack (c) 2022
+ #
+ # @page License
+ # Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ # modify it under the terms of the GNU Lesser General Public License
+ # version 3 as published by the Free Software Foundation. You should
+ # have received a copy of the GNU Lesser General Public License along
+ # with this program, see LICENSE.md file for more details.
+ # This program is distributed WITHOUT ANY WARRANTY.
+##
+#
+# Usage: mtbdec.py <firmware.elf> [capture]
+#
+# The capture (or stdin) is the output of the debug UART, only the lines
+# starting with "mtb," (see src/mtb.c) are used. Each branch is printed with
+# source and destination as function+offset, using the symbols of the ELF,
+# and the object file found into the map file (same name as the ELF, with
+# ".map" extension) when it exists. A summary counts branches per function,
+# polling loops are the functions with the most branches.
+#
+import os
+import re
+import struct
+import sys
+
+def load_symbols(path):
+    elf = open(path, "rb").read()
+    if elf[0:4] != b"\x7fELF" or elf[4] != 1:
+        sys.exit("mtbdec: %s is not an ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", elf, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+    sections = []
+    for i in range(shnum):
+        sh = struct.unpack_from("<IIIIIIIIII", elf, shoff + i * shentsize)
+        sections.append(sh)
+    syms = []
+    for sh in sections:
+        if sh[1] != 2: # SHT_SYMTAB
+            continue
+        strtab = sections[sh[6]]
+        for off in range(sh[4], sh[4] + sh[5], 16):
+            name, value, size, info, other, shndx = \
+                struct.unpack_from("<IIIBBH", elf, off)
+            if (info & 0x0F) != 2 or size == 0: # STT_FUNC
+                continue
+            start = strtab[4] + name
+            end = elf.index(b"\0", start)
+            syms.append((value & ~1, size, elf[start:end].decode("ascii")))
+    syms.sort()
+    return syms
+
+def load_map(path):
+    objs = []
+    if not os.path.exists(path):
+        return objs
+    rx = re.compile(r"^\s*(?:\.\S+)?\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+\.o)$")
+    for line in open(path, errors="replace"):
+        m = rx.match(line.rstrip())
+        if m and int(m.group(2), 16):
+            objs.append((int(m.group(1), 16), int(m.group(2), 16),
+                         os.path.basename(m.group(3))))
+    objs.sort()
+    return objs
+
+def find(table, addr):
+    for start, size, name in table:
+        if start <= addr < start + size:
+            return start, name
+    return None, None
+
+def where(syms, objs, addr):
+    start, name = find(syms, addr)
+    s = "%s+0x%x" % (name, addr - start) if name else "0x%08x" % addr
+    _, obj = find(objs, addr)
+    return s + (" (%s)" % obj if obj else ""), name
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: mtbdec.py <firmware.elf> [capture]")
+    syms = load_symbols(sys.argv[1])
+    objs = load_map(os.path.splitext(sys.argv[1])[0] + ".map")
+    src = open(sys.argv[2], "rb") if len(sys.argv) > 2 else sys.stdin.buffer
+    count = {}
+    n = 0
+    for line in src:
+        m = re.search(r"mtb,([0-9a-z]+)(?:,([0-9a-f]+))?(?:,([0-9a-f]+))?(?:,([0-9a-f]+))?",
+                      line.decode("latin-1"))
+        if not m:
+            continue
+        tag = m.group(1)
+        if tag == "fault":
+            pc, lr, psr = (int(m.group(i), 16) for i in (2, 3, 4))
+            print("HardFault pc=%s" % where(syms, objs, pc)[0])
+            print("          lr=%s xpsr=%08x" % (where(syms, objs, lr & ~1)[0], psr))
+        elif tag == "begin":
+            print("Trace of %s branches (oldest first)" % m.group(2))
+            count = {}
+            n = 0
+        elif tag == "end":
+            print("Branches per function (destination) :")
+            for name, c in sorted(count.items(), key=lambda x: -x[1]):
+                print("  %6d %5.1f%% %s" % (c, 100.0 * c / max(n, 1), name))
+        elif m.group(2):
+            s, d = int(tag, 16), int(m.group(2), 16)
+            flags = ("E" if s & 1 else " ") + ("S" if d & 1 else " ")
+            dst, name = where(syms, objs, d & ~1)
+            print("  %4d %s %s -> %s" % (n, flags, where(syms, objs, s & ~1)[0], dst))
+            count[name or "?"] = count.get(name or "?", 0) + 1
+            n += 1
+
+if __name__ == "__main__":
+    main()
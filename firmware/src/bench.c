@@ -0,0 +1,420 @@
+/**
+ * @file  bench.c
+ * @brief Micro-benchmark runner, linked instead of main.c ("make bench")
+ *
+ * Each benchmark runs one operation of the drivers many times and measures
+ * every run with the cycle counter of prof.c, or with TC3 at 1MHz from
+ * OSC8M for operations that change the CPU clock (this counter is not
+ * modified by clk_set). A setup function, not measured, is called
+ * before each run to put the driver in a known state.
+ *
+ * Results are sent to the debug UART as CSV lines starting with "bench,",
+ * other bytes (output of the UART benchmarks) must be ignored :
+ *   bench,name,iterations,unit,total,min,max,per_op,bytes_per_op,cpu_hz,ramfunc
+ * Per operation time is per_op / cpu_hz for "cyc" unit and bytes/s is
+ * bytes_per_op * cpu_hz / per_op (computed on host side, the firmware does
+ * not have division). The ramfunc column tells if RAMFUNC functions run
+ * from SRAM (1) or flash (0, "make RAMFUNC=0 bench"), so the results of
+ * both builds can be compared. Send 'b' to run the benchmarks again.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "clock.h"
+#include "display.h"
+#include "fmt.h"
+#include "gfx.h"
+#include "hardware.h"
+#include "prof.h"
+#include "timer.h"
+#include "uart.h"
+
+#ifndef PROF_ENABLE
+#error "Benchmarks use cycle counter of prof.c, build with make bench"
+#endif
+
+#define BENCH_CYC 0 /* Measured in CPU cycles (prof_now) */
+#define BENCH_US  1 /* Measured in microseconds (TC3, see bench_us) */
+
+/* Placement of RAMFUNC functions, printed with each result */
+#ifdef RAMFUNC_DISABLE
+#define BENCH_RAMFUNC 0
+#else
+#define BENCH_RAMFUNC 1
+#endif
+
+struct bench
+{
+	const char *name;
+	void (*setup)(void);   /* Called before each run (not measured)  */
+	void (*op)(uint i);    /* Measured operation                     */
+	u8 shift;              /* Number of runs, as a power of 2        */
+	u8 unit;               /* BENCH_CYC or BENCH_US                  */
+	u8 bytes;              /* Bytes processed by one operation       */
+};
+
+static void bench_all(void);
+static u32  bench_divmod(u32 n, u32 d, u32 *r);
+static void bench_one(const struct bench *b);
+static void bench_put(char c);
+static u16  bench_us(void);
+static void bench_us_init(void);
+static void op_blit(uint i);
+static void op_clear(uint i);
+static void op_clk(uint i);
+static void op_div_naive(uint i);
+static void op_divu10(uint i);
+static void op_empty(uint i);
+static void op_fmt_u(uint i);
+static void op_pos(uint i);
+static void op_putc(uint i);
+static void op_puts(uint i);
+static void op_uart_dump(uint i);
+static void op_uart_isr(uint i);
+static void op_uart_puts(uint i);
+static void op_utoa_naive(uint i);
+static void setup_dbg(void);
+static void setup_fill(void);
+static void setup_isr(void);
+static void setup_line(void);
+/* Interrupt handler of the debug UART (see uart.c) */
+RAMFUNC void SERCOM2_Handler(void);
+
+static char bench_text[] = "The quick brown fox";
+static u8   bench_buf[32];
+/* Results of computations, so they are not removed by the compiler */
+static volatile u32 bench_sink;
+
+static const struct bench benchs[] = {
+	{ "empty",      0,          op_empty,     8, BENCH_CYC,  0 },
+	{ "disp_putc",  setup_line, op_putc,      8, BENCH_CYC,  1 },
+	{ "disp_puts",  setup_line, op_puts,      8, BENCH_CYC, sizeof(bench_text) - 1 },
+	{ "disp_clear", setup_fill, op_clear,     6, BENCH_CYC, 0 },
+	{ "disp_pos",   0,          op_pos,       8, BENCH_CYC,  0 },
+	{ "gfx_blit",   0,          op_blit,      8, BENCH_CYC,  0 },
+	{ "uart_puts",  setup_dbg,  op_uart_puts, 4, BENCH_CYC, sizeof(bench_text) + 1 },
+	{ "uart_dump",  setup_dbg,  op_uart_dump, 4, BENCH_CYC, sizeof(bench_buf) },
+	{ "uart_isr",   setup_isr,  op_uart_isr,  6, BENCH_CYC,  1 },
+	{ "clk_full",   setup_dbg,  op_clk,       3, BENCH_US,   0 },
+	/* Formatter : fmt_divu10 and fmt_print against shift-subtract division */
+	{ "div10_naive", 0,         op_div_naive,  8, BENCH_CYC,  0 },
+	{ "fmt_divu10",  0,         op_divu10,     8, BENCH_CYC,  0 },
+	{ "utoa_naive",  0,         op_utoa_naive, 8, BENCH_CYC, 10 },
+	{ "fmt_print_u", 0,         op_fmt_u,      8, BENCH_CYC, 10 },
+};
+
+/**
+ * @brief Entry point of the benchmark firmware
+ *
+ */
+int main(void)
+{
+	u8 c;
+
+	hw_init();
+	timer_init(0);
+	prof_init(0);
+	uart_init();
+	disp_init();
+	bench_us_init();
+
+	bench_all();
+	while (1)
+	{
+		if ((uart_read(UART_DBG, &c, 1) == 1) && (c == 'b'))
+			bench_all();
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Run all benchmarks and print the results
+ *
+ */
+static void bench_all(void)
+{
+	uint i;
+
+	for (i = 0; i < sizeof(bench_buf); i++)
+		bench_buf[i] = i;
+
+	uart_printf("\r\nbench,name,iterations,unit,total,min,max,per_op,"
+	            "bytes_per_op,cpu_hz,ramfunc\r\n");
+	for (i = 0; i < (sizeof(benchs) / sizeof(benchs[0])); i++)
+		bench_one(&benchs[i]);
+	uart_flush(UART_DBG);
+}
+
+/**
+ * @brief Naive division, one bit of quotient per iteration (shift-subtract)
+ *
+ * This is the reference for fmt_divu10, as simple as the code generated for
+ * a division without libgcc helper.
+ *
+ * @param n Dividend
+ * @param d Divisor (not zero)
+ * @param r Pointer to a variable where remainder is stored
+ * @return u32 Quotient of n / d
+ */
+static u32 bench_divmod(u32 n, u32 d, u32 *r)
+{
+	u32 q = 0, rem = 0;
+	int b;
+
+	for (b = 31; b >= 0; b--)
+	{
+		rem = (rem << 1) | ((n >> b) & 1);
+		if (rem >= d)
+		{
+			rem -= d;
+			q |= (1UL << b);
+		}
+	}
+	*r = rem;
+	return(q);
+}
+
+/**
+ * @brief Run one benchmark and print its result
+ *
+ * @param b Pointer to the benchmark description
+ */
+static void bench_one(const struct bench *b)
+{
+	u32 total, min, max, t;
+	uint i, n;
+
+	n = (1 << b->shift);
+	total = 0;
+	min = 0xFFFFFFFF;
+	max = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (b->setup)
+			b->setup();
+		if (b->unit == BENCH_US)
+		{
+			t = bench_us();
+			b->op(i);
+			t = (u16)(bench_us() - t);
+		}
+		else
+		{
+			t = prof_now();
+			b->op(i);
+			t = prof_now() - t;
+		}
+		total += t;
+		if (t < min)
+			min = t;
+		if (t > max)
+			max = t;
+	}
+	uart_flush(UART_DBG);
+	uart_printf("\r\nbench,%s,%u,%s,%u,%u,%u,%u,%u,%u,%u\r\n", b->name, n,
+	            (b->unit == BENCH_US) ? "us" : "cyc", total, min, max,
+	            total >> b->shift, b->bytes, clk_cpu_freq(), BENCH_RAMFUNC);
+}
+
+/**
+ * @brief Output function of fmt_print benchmarks (characters are dropped)
+ *
+ * @param c Character to output
+ */
+static void bench_put(char c)
+{
+	bench_sink += c;
+}
+
+/**
+ * @brief Read the microsecond counter (TC3)
+ *
+ * @return u16 Current value of the counter (wraps after 65ms)
+ */
+static u16 bench_us(void)
+{
+	/* COUNT is continuously synchronized (READREQ.RCONT) */
+	return(reg16_rd(TC3_ADDR + 0x10));
+}
+
+/**
+ * @brief Start TC3 as a 16 bits counter at 1MHz
+ *
+ * TC3 is clocked by GCLK1 (OSC8M, never stopped by clk_set) divided by 8,
+ * so durations that include a change of CPU clock are measured correctly.
+ */
+static void bench_us_init(void)
+{
+	/* Enable TC3 clock (APBCMASK) */
+	reg_set(PM_ADDR + 0x20, (1 << 11));
+	/* Connect GCLK1 (OSC8M) to TC3 */
+	reg16_wr(GCLK_ADDR + 0x02, (1 << 14) | (1 << 8) | 0x1B);
+
+	/* Reset TC3 */
+	reg16_wr(TC3_ADDR + 0x00, 0x0001);
+	while (reg16_rd(TC3_ADDR + 0x00) & 0x0001)
+		;
+	/* COUNT16 mode, prescaler DIV8, then enable */
+	reg16_wr(TC3_ADDR + 0x00, (3 << 8));
+	reg16_wr(TC3_ADDR + 0x00, (3 << 8) | (1 << 1));
+	while (reg8_rd(TC3_ADDR + 0x0F) & 0x80)
+		;
+	/* Continuous read synchronization of COUNT */
+	reg16_wr(TC3_ADDR + 0x02, (1 << 15) | (1 << 14) | 0x10);
+	while (reg8_rd(TC3_ADDR + 0x0F) & 0x80)
+		;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                        Measured operations                           -- */
+/* -------------------------------------------------------------------------- */
+
+/* Bitmap of 16x10 pixels over 2 pages (not aligned), always modified */
+static void op_blit(uint i)
+{
+	gfx_blit(i & 0x3F, 3, bench_buf, 16, 10, GFX_INV);
+}
+
+static void op_clear(uint i)
+{
+	(void)i;
+	disp_clear(0xFF);
+}
+
+/* Stop then restart DFLL48M, the longest part of clock init */
+static void op_clk(uint i)
+{
+	(void)i;
+	clk_set(CLK_ECO);
+	clk_set(CLK_FULL);
+}
+
+/* Values with 10 digits, different for each run */
+#define BENCH_VAL(i) (0xF0000000 | ((i) * 0x9E3779B1))
+
+static void op_div_naive(uint i)
+{
+	u32 r;
+
+	bench_sink = bench_divmod(BENCH_VAL(i), 10, &r) + r;
+}
+
+static void op_divu10(uint i)
+{
+	uint r;
+
+	bench_sink = fmt_divu10(BENCH_VAL(i), &r) + r;
+}
+
+/* Cost of the measurement itself */
+static void op_empty(uint i)
+{
+	(void)i;
+}
+
+static void op_pos(uint i)
+{
+	disp_pos(i & 15, i & 7);
+}
+
+static void op_putc(uint i)
+{
+	disp_putc('A' + (i & 15));
+}
+
+static void op_fmt_u(uint i)
+{
+	fmt_print(bench_put, "%u", BENCH_VAL(i));
+}
+
+static void op_puts(uint i)
+{
+	(void)i;
+	disp_puts(bench_text);
+}
+
+static void op_uart_dump(uint i)
+{
+	(void)i;
+	uart_dump(bench_buf, sizeof(bench_buf));
+}
+
+/* Handler called directly, to send the byte queued by setup_isr */
+static void op_uart_isr(uint i)
+{
+	(void)i;
+	SERCOM2_Handler();
+	/* Buffer is empty : disable DRE, then SERCOM2 interrupt again */
+	reg8_wr(UART_DBG + 0x14, 0x01);
+	reg_wr(NVIC_ADDR + 0x00, (1 << 11));
+}
+
+static void op_uart_puts(uint i)
+{
+	(void)i;
+	uart_puts(bench_text);
+	uart_crlf();
+}
+
+/* Decimal conversion with naive division, the work of fmt_print for %u */
+static void op_utoa_naive(uint i)
+{
+	u32 v = BENCH_VAL(i);
+	u32 r;
+
+	do
+	{
+		v = bench_divmod(v, 10, &r);
+		bench_put('0' + r);
+	} while (v);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                          Setup functions                             -- */
+/* -------------------------------------------------------------------------- */
+
+/* Empty the transmit buffer, so operations are not slowed by the UART */
+static void setup_dbg(void)
+{
+	uart_flush(UART_DBG);
+}
+
+/* Queue one byte with SERCOM2 interrupt masked, for op_uart_isr */
+static void setup_isr(void)
+{
+	uart_flush(UART_DBG);
+	reg_wr(NVIC_ADDR + 0x80, (1 << 11)); /* ICER */
+	uart_write(UART_DBG, (const u8 *)"U", 1);
+}
+
+/* Draw text on all lines, so disp_clear has columns to modify */
+static void setup_fill(void)
+{
+	uint p;
+
+	for (p = 0; p < DISP_PAGES; p++)
+	{
+		disp_pos(0, p);
+		disp_puts(bench_text);
+	}
+}
+
+/* Go back to the start of a line */
+static void setup_line(void)
+{
+	disp_pos(0, 2);
+}
+/* EOF */
@@ -0,0 +1,315 @@
+/**
+ * @file  button.c
+ * @brief Pushbuttons driver (debounce, long press, repeat and chords)
+ *
+ * Buttons are sampled periodically by the RTC compare interrupt, and a
+ * button state changes only after BTN_DEBOUNCE identical samples. When no
+ * button is pressed, the RTC interrupt rate is reduced (BTN_IDLE) and the
+ * EIC wakes the driver on the first edge. SW1 (PA27) and SW5 (PA15) share
+ * the same external interrupt line (EXTINT15), so SW1 is not connected to
+ * the EIC and is detected by the slow idle sampling.
+ *
+ * Input latency is bounded : (BTN_DEBOUNCE + 1) * BTN_TICK for SW2-SW5 and
+ * BTN_IDLE + BTN_DEBOUNCE * BTN_TICK for SW1.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "button.h"
+#include "gpio.h"
+#include "hardware.h"
+#include "timer.h"
+
+/* Sampling periods, in RTC ticks (1024 Hz) */
+#define BTN_TICK       8  /* Sampling period when a button is active */
+#define BTN_IDLE      32  /* Sampling period when no button is used  */
+#define BTN_DEBOUNCE   3  /* Number of identical samples             */
+#define BTN_LONG_MS   800
+#define BTN_REPEAT_MS 150
+
+/* Size of the events queue (must be a power of 2) */
+#define BTN_QUEUE 16
+
+/* External interrupt lines of SW2 (PA11), SW3 (PA14), SW4 (PA10), SW5 (PA15) */
+#define BTN_EIC_MASK ((1 << 10) | (1 << 11) | (1 << 14) | (1 << 15))
+
+static void btn_event(u8 type, u8 button, u32 time);
+static uint btn_read(void);
+static void btn_sample(u32 rtc);
+static void btn_schedule(u32 time);
+
+/* Port pin of each button */
+static const u32 btn_pin[BTN_COUNT] = {
+	GPIO(PIN_SW1), GPIO(PIN_SW2), GPIO(PIN_SW3), GPIO(PIN_SW4), GPIO(PIN_SW5)
+};
+#define BTN_PINS (GPIO(PIN_SW1) | GPIO(PIN_SW2) | GPIO(PIN_SW3) | \
+                  GPIO(PIN_SW4) | GPIO(PIN_SW5))
+
+static struct btn_event btn_queue[BTN_QUEUE];
+static volatile uint btn_head; /* Updated by interrupts  */
+static volatile uint btn_tail; /* Updated by btn_get()   */
+
+static void (*btn_wake)(void);
+static volatile uint btn_stable; /* Debounced state (bitmask of pressed)  */
+static uint btn_long;            /* Buttons that reached long press delay */
+static uint btn_chord;           /* Last reported chord                   */
+static uint btn_idle;            /* Set when sampling at slow rate        */
+static u8   btn_cnt [BTN_COUNT]; /* Number of samples different of state  */
+static u32  btn_next[BTN_COUNT]; /* Time of next LONG or REPEAT (ms)      */
+
+/**
+ * @brief Initialize the buttons driver (EIC and RTC)
+ *
+ * IOs are configured by hw_init_button().
+ *
+ * @param wake Function called (from interrupt) when an event is queued
+ */
+void btn_init(void (*wake)(void))
+{
+	btn_wake = wake;
+
+	/* Enable EIC and RTC into PM (APBAMASK) */
+	reg_set(PM_ADDR + 0x18, (1 << 6) | (1 << 5));
+	/* Use GCLK5 (32kHz) for RTC and EIC */
+	reg16_wr(GCLK_ADDR + 0x02, (1 << 14) | (5 << 8) | 0x04);
+	reg16_wr(GCLK_ADDR + 0x02, (1 << 14) | (5 << 8) | 0x05);
+
+	/* Reset RTC */
+	reg16_wr(RTC_ADDR + 0x00, (1 << 0));
+	while (reg8_rd(RTC_ADDR + 0x0A) & 0x80)
+		;
+	/* Mode 0 (32 bits counter), prescaler 32 : 1024 Hz */
+	reg16_wr(RTC_ADDR + 0x00, (5 << 8) | (0 << 2));
+	/* Continuous read synchronization of COUNT */
+	reg16_wr(RTC_ADDR + 0x02, (1 << 15) | (1 << 14) | 0x10);
+	while (reg8_rd(RTC_ADDR + 0x0A) & 0x80)
+		;
+	reg_wr(RTC_ADDR + 0x18, BTN_IDLE);
+	btn_idle = 1;
+	/* Enable compare 0 interrupt, then RTC */
+	reg8_wr(RTC_ADDR + 0x07, (1 << 0));
+	reg16_wr(RTC_ADDR + 0x00, reg16_rd(RTC_ADDR + 0x00) | (1 << 1));
+	while (reg8_rd(RTC_ADDR + 0x0A) & 0x80)
+		;
+
+	/* Configure EXTINT 10, 11, 14, 15 : both edges, with filter */
+	reg_wr(EIC_ADDR + 0x1C, (0xB << 8) | (0xB << 12) |
+	                        (0xB << 24) | (0xB << 28));
+	reg_wr(EIC_ADDR + 0x10, BTN_EIC_MASK);
+	reg_wr(EIC_ADDR + 0x0C, BTN_EIC_MASK);
+	/* Enable EIC */
+	reg8_wr(EIC_ADDR + 0x00, (1 << 1));
+	while (reg8_rd(EIC_ADDR + 0x01) & 0x80)
+		;
+
+	/* Enable RTC (3) and EIC (4) interrupts into NVIC */
+	reg_wr(NVIC_ADDR + 0x00, (1 << 3) | (1 << 4));
+}
+
+/**
+ * @brief Get the next button event
+ *
+ * @param ev Pointer to a structure where the event is copied
+ * @return integer One if an event has been copied, zero if queue is empty
+ */
+int btn_get(struct btn_event *ev)
+{
+	uint tail = btn_tail;
+
+	if (tail == btn_head)
+		return(0);
+	*ev = btn_queue[tail];
+	btn_tail = (tail + 1) & (BTN_QUEUE - 1);
+	return(1);
+}
+
+/**
+ * @brief Get the current (debounced) state of buttons
+ *
+ * @return uint Bitmask of pressed buttons (bit N for button N)
+ */
+uint btn_state(void)
+{
+	return(btn_stable);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Add an event into the queue
+ *
+ * If the queue is full, the event is discarded.
+ *
+ * @param type   Type of the event (BTN_EV_xxx)
+ * @param button Index of the button (or bitmask for chords)
+ * @param time   Timestamp of the event
+ */
+static void btn_event(u8 type, u8 button, u32 time)
+{
+	uint head = btn_head;
+	uint next = (head + 1) & (BTN_QUEUE - 1);
+
+	if (next == btn_tail)
+		return;
+	btn_queue[head].type   = type;
+	btn_queue[head].button = button;
+	btn_queue[head].time   = time;
+	btn_head = next;
+	if (btn_wake)
+		btn_wake();
+}
+
+/**
+ * @brief Read the current (raw) state of buttons
+ *
+ * @return uint Bitmask of pressed buttons (bit N for button N)
+ */
+static uint btn_read(void)
+{
+	u32  in = gpio_read(BTN_PINS);
+	uint state = 0;
+	uint i;
+
+	/* Buttons are active low */
+	for (i = 0; i < BTN_COUNT; i++)
+		if ((in & btn_pin[i]) == 0)
+			state |= (1 << i);
+	return(state);
+}
+
+/**
+ * @brief Sample buttons and update their state machine
+ *
+ * @param rtc Current value of the RTC counter
+ */
+static void btn_sample(u32 rtc)
+{
+	u32  now = timer_ms();
+	uint raw = btn_read();
+	uint stable = btn_stable;
+	uint busy = 0;
+	uint bit;
+	uint i;
+
+	for (i = 0; i < BTN_COUNT; i++)
+	{
+		bit = (1 << i);
+
+		/* Debounce : state changes after N identical samples */
+		if ((raw ^ stable) & bit)
+		{
+			busy = 1;
+			if (++btn_cnt[i] >= BTN_DEBOUNCE)
+			{
+				btn_cnt[i] = 0;
+				stable ^= bit;
+				if (stable & bit)
+				{
+					btn_event(BTN_EV_PRESS, i, now);
+					btn_next[i] = now + BTN_LONG_MS;
+				}
+				else
+				{
+					btn_event(BTN_EV_RELEASE, i, now);
+					btn_long &= ~bit;
+				}
+			}
+		}
+		else
+			btn_cnt[i] = 0;
+
+		/* Long press, then auto-repeat */
+		if ((stable & bit) && ((s32)(now - btn_next[i]) >= 0))
+		{
+			btn_event((btn_long & bit) ? BTN_EV_REPEAT : BTN_EV_LONG, i, now);
+			btn_long |= bit;
+			btn_next[i] = now + BTN_REPEAT_MS;
+		}
+	}
+
+	/* Chord : a new combination of two (or more) buttons */
+	if ((stable & (stable - 1)) == 0)
+		btn_chord = 0;
+	else if (stable & ~btn_chord)
+	{
+		btn_event(BTN_EV_CHORD, stable, now);
+		btn_chord = stable;
+	}
+	btn_stable = stable;
+
+	if (busy || stable)
+	{
+		btn_idle = 0;
+		btn_schedule(rtc + BTN_TICK);
+	}
+	else
+	{
+		/* Nothing to do, wait for next edge (or slow sampling of SW1) */
+		if (btn_idle == 0)
+		{
+			reg_wr(EIC_ADDR + 0x10, BTN_EIC_MASK);
+			reg_wr(EIC_ADDR + 0x0C, BTN_EIC_MASK);
+		}
+		btn_idle = 1;
+		btn_schedule(rtc + BTN_IDLE);
+	}
+}
+
+/**
+ * @brief Set the time of the next RTC compare interrupt
+ *
+ * @param time Value of the RTC counter for next interrupt
+ */
+static void btn_schedule(u32 time)
+{
+	reg_wr(RTC_ADDR + 0x18, time);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                      Interrupt  handlers                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Interrupt handler for EIC (first edge of a button)
+ *
+ * Edge interrupts are disabled until all buttons are released, next edges
+ * (bounces) are handled by the periodic sampling.
+ */
+void EIC_Handler(void)
+{
+	u32 flags = reg_rd(EIC_ADDR + 0x10);
+
+	reg_wr(EIC_ADDR + 0x10, flags);
+	reg_wr(EIC_ADDR + 0x08, BTN_EIC_MASK);
+	if (btn_idle)
+	{
+		btn_idle = 0;
+		btn_schedule(reg_rd(RTC_ADDR + 0x10) + BTN_TICK);
+	}
+}
+
+/**
+ * @brief Interrupt handler for RTC (periodic sampling of buttons)
+ *
+ */
+void RTC_Handler(void)
+{
+	/* Clear CMP0 flag */
+	reg8_wr(RTC_ADDR + 0x08, (1 << 0));
+	btn_sample(reg_rd(RTC_ADDR + 0x10));
+}
+/* EOF */
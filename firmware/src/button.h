@@ -0,0 +1,46 @@
+/**
+ * @file  button.h
+ * @brief Definitions and prototypes for the pushbuttons driver
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef BUTTON_H
+#define BUTTON_H
+#include "types.h"
+
+#define BTN_SW1   0
+#define BTN_SW2   1
+#define BTN_SW3   2
+#define BTN_SW4   3
+#define BTN_SW5   4
+#define BTN_COUNT 5
+
+/* Types of events */
+#define BTN_EV_PRESS   1
+#define BTN_EV_RELEASE 2
+#define BTN_EV_LONG    3 /* Button held longer than BTN_LONG_MS        */
+#define BTN_EV_REPEAT  4 /* Sent every BTN_REPEAT_MS after a long press */
+#define BTN_EV_CHORD   5 /* Two or more buttons pressed together       */
+
+struct btn_event
+{
+	u8  type;   /* Type of event (BTN_EV_xxx)                         */
+	u8  button; /* Index of the button (bitmask of buttons for CHORD) */
+	u32 time;   /* Timestamp (see timer_ms)                           */
+};
+
+void btn_init(void (*wake)(void));
+int  btn_get(struct btn_event *ev);
+uint btn_state(void);
+
+#endif
+/* EOF */
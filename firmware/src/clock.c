@@ -0,0 +1,211 @@
+/**
+ * @file  clock.c
+ * @brief Clock performance profiles, switched at runtime
+ *
+ * A profile selects the source of the CPU clock (GCLK0), the flash wait
+ * states and if the DFLL48M is running. On a change, the modules that
+ * depend on clocks are updated : SysTick (timer), SPI of the display and
+ * UART baudrates. OSC8M (GCLK1) and OSC32K (GCLK5) are always running.
+ *
+ * There is no 32kHz profile : with a 1ms SysTick the period would be 33
+ * cycles, shorter than the interrupt itself.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "clock.h"
+#include "display.h"
+#include "hardware.h"
+#include "timer.h"
+#include "uart.h"
+
+struct clk_profile
+{
+	const char *name;
+	u8  src;     /* Source of GCLK0 (GENCTRL.SRC)           */
+	u8  rws;     /* Flash read wait states                  */
+	u8  dfll;    /* Set if DFLL48M must be running          */
+	u32 freq;    /* CPU frequency (Hz)                      */
+	u32 load;    /* SysTick reload value                    */
+	u32 us_mul;  /* SysTick cycles to us (see timer.h)      */
+};
+
+static void clk_dfll(uint enable);
+static void clk_gen(uint gen, uint src, uint enable);
+static void clk_rws(uint rws);
+
+static const struct clk_profile clk_profiles[CLK_COUNT] = {
+	[CLK_FULL] = { "full", 0x07, 1, 1, 48000000,
+	               TIMER_LOAD(48000000), TIMER_US_MUL(48000000) },
+	[CLK_ECO]  = { "eco",  0x06, 0, 0,  8000000,
+	               TIMER_LOAD(8000000),  TIMER_US_MUL(8000000)  },
+};
+
+/* Profile configured by hw_init_clock() */
+static uint clk_cur = CLK_FULL;
+/* Value of DFLLCTRL, used to restart DFLL with the same configuration */
+static u16  clk_dfll_cfg;
+
+/**
+ * @brief Get the current CPU frequency
+ *
+ * @return u32 Frequency in Hz
+ */
+u32 clk_cpu_freq(void)
+{
+	return(clk_profiles[clk_cur].freq);
+}
+
+/**
+ * @brief Get the name of a profile
+ *
+ * @param profile Index of the profile (CLK_xxx)
+ * @return char* Pointer to the name
+ */
+const char *clk_name(uint profile)
+{
+	if (profile >= CLK_COUNT)
+		return("?");
+	return(clk_profiles[profile].name);
+}
+
+/**
+ * @brief Get the current profile
+ *
+ * @return uint Index of the current profile (CLK_xxx)
+ */
+uint clk_profile(void)
+{
+	return(clk_cur);
+}
+
+/**
+ * @brief Switch to another clock profile
+ *
+ * Transfers in progress (display flush, UART transmit) are finished before
+ * the change, then SPI and UART are moved to running clocks. A profile
+ * without DFLL48M is refused when a UART baudrate can not be reached from
+ * OSC8M (above 500000), to keep the links working.
+ *
+ * This function must not be called from interrupt.
+ *
+ * @param profile Index of the new profile (CLK_xxx)
+ * @return integer Zero on success, -1 if profile is not valid or can not be
+ *         used with current UART baudrates
+ */
+int clk_set(uint profile)
+{
+	const struct clk_profile *cur, *next;
+
+	if (profile >= CLK_COUNT)
+		return(-1);
+	if (profile == clk_cur)
+		return(0);
+	cur  = &clk_profiles[clk_cur];
+	next = &clk_profiles[profile];
+	if ((next->dfll != cur->dfll) && uart_clock_check(next->dfll))
+		return(-1);
+
+	/* Start DFLL before using it */
+	if (next->dfll && ! cur->dfll)
+	{
+		clk_dfll(1);
+		clk_gen(7, 0x07, 1);
+	}
+	/* Wait states must be increased before the frequency */
+	if (next->rws > cur->rws)
+		clk_rws(next->rws);
+
+	clk_gen(0, next->src, 1);
+	timer_clock(next->load, next->us_mul);
+
+	if (next->rws < cur->rws)
+		clk_rws(next->rws);
+
+	/* Move peripherals to the clocks of the new profile */
+	if (next->dfll != cur->dfll)
+	{
+		disp_clock(next->dfll);
+		uart_clock(next->dfll);
+	}
+	/* Stop DFLL when no more used */
+	if (cur->dfll && ! next->dfll)
+	{
+		clk_gen(7, 0x07, 0);
+		clk_dfll(0);
+	}
+	clk_cur = profile;
+	return(0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Start or stop the DFLL48M
+ *
+ * DFLL is configured by hw_init_clock(), its configuration is saved when
+ * stopped and used again to restart it.
+ *
+ * @param enable Non-zero to start DFLL, zero to stop it
+ */
+static void clk_dfll(uint enable)
+{
+	/* Wait DFLL ready before any write to DFLLCTRL */
+	while ( ! (reg_rd(SYSCTRL_ADDR + 0x0C) & 0x10))
+		;
+	if (enable)
+	{
+		reg16_wr(SYSCTRL_ADDR + 0x24, (1 << 1));
+		while ( ! (reg_rd(SYSCTRL_ADDR + 0x0C) & 0x10))
+			;
+		reg16_wr(SYSCTRL_ADDR + 0x24, clk_dfll_cfg);
+		while ( ! (reg_rd(SYSCTRL_ADDR + 0x0C) & 0x10))
+			;
+	}
+	else
+	{
+		clk_dfll_cfg = reg16_rd(SYSCTRL_ADDR + 0x24);
+		reg16_wr(SYSCTRL_ADDR + 0x24, clk_dfll_cfg & ~(1 << 1));
+	}
+}
+
+/**
+ * @brief Configure a generic clock generator (without divisor)
+ *
+ * @param gen    Index of the generator
+ * @param src    Clock source (GENCTRL.SRC)
+ * @param enable Non-zero to enable the generator
+ */
+static void clk_gen(uint gen, uint src, uint enable)
+{
+	reg_wr(GCLK_ADDR + 0x08, (1 << 8) | gen);
+	reg_wr(GCLK_ADDR + 0x04, ((enable ? 1 : 0) << 16) | (src << 8) | gen);
+	/* Wait end of clock domains synchronization */
+	while (reg8_rd(GCLK_ADDR + 0x01) & 0x80)
+		;
+}
+
+/**
+ * @brief Set the number of flash read wait states
+ *
+ * @param rws Number of wait states (see datasheet table 37-40)
+ */
+static void clk_rws(uint rws)
+{
+	u32 v = reg_rd(NVM_ADDR + 0x04);
+
+	reg_wr(NVM_ADDR + 0x04, (v & ~(0x0F << 1)) | (rws << 1));
+}
+/* EOF */
@@ -0,0 +1,30 @@
+/**
+ * @file  clock.h
+ * @brief Definitions and prototypes for clock performance profiles
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef CLOCK_H
+#define CLOCK_H
+#include "types.h"
+
+#define CLK_FULL  0 /* CPU at 48MHz (DFLL48M)                  */
+#define CLK_ECO   1 /* CPU at 8MHz (OSC8M), DFLL48M stopped    */
+#define CLK_COUNT 2
+
+u32  clk_cpu_freq(void);
+const char *clk_name(uint profile);
+uint clk_profile(void);
+int  clk_set(uint profile);
+
+#endif
+/* EOF */
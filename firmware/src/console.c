@@ -0,0 +1,118 @@
+/**
+ * @file  console.c
+ * @brief Scrolling text console (log view) using the whole display
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "console.h"
+#include "display.h"
+#include "types.h"
+
+static void con_newline(void);
+
+/* Page (into display RAM) of the current line */
+static uint con_row;
+/* Number of lines written since init (saturated to the number of pages) */
+static uint con_lines;
+/* Horizontal position into current line (in pixels) */
+static uint con_x;
+
+/**
+ * @brief Initialize the console, clear the display
+ *
+ * The console uses the whole display. When the screen is full, each new
+ * line is written into the page of the oldest one, then the display start
+ * line is moved by one page : content already on screen is never redrawn.
+ * Text is drawn with the current font settings (see disp_scale), which must
+ * use one page per line.
+ */
+void con_init(void)
+{
+	disp_clear(0xFF);
+	disp_scroll(0);
+	con_row   = 0;
+	con_lines = 1;
+	con_x     = 0;
+	disp_pos(0, con_row);
+}
+
+/**
+ * @brief Write one character to the console
+ *
+ * Carriage-return moves to the start of current line, line-feed starts a
+ * new line. Long lines are wrapped. The display is updated by next flush.
+ *
+ * @param c Character to write
+ */
+void con_putc(char c)
+{
+	char s[2];
+	uint w;
+
+	if (c == '\n')
+	{
+		con_newline();
+		return;
+	}
+	if (c == '\r')
+	{
+		con_x = 0;
+		disp_pos(0, con_row);
+		return;
+	}
+
+	s[0] = c;
+	s[1] = 0;
+	w = disp_width(s);
+	// Not enough space for this char, wrap to next line
+	if ((con_x + w) > DISP_WIDTH)
+		con_newline();
+	disp_putc(c);
+	con_x += w;
+}
+
+/**
+ * @brief Write a text-string to the console
+ *
+ * @param s Pointer to the nul terminated text-string
+ */
+void con_puts(char *s)
+{
+	while(*s)
+		con_putc(*s++);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                      Private console functions                       -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Start a new line (and scroll when the screen is full)
+ *
+ */
+static void con_newline(void)
+{
+	con_row = (con_row + 1) & (DISP_PAGES - 1);
+	con_x   = 0;
+
+	if (con_lines < DISP_PAGES)
+		con_lines++;
+	else
+	{
+		// Re-use the page of the oldest line
+		disp_clear(1 << con_row);
+		// Show the page after it on top of the screen
+		disp_scroll(((con_row + 1) & (DISP_PAGES - 1)) << 3);
+	}
+	disp_pos(0, con_row);
+}
+/* EOF */
@@ -0,0 +1,24 @@
+/**
+ * @file  console.h
+ * @brief Definitions and prototypes for the scrolling text console
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+void con_init(void);
+void con_putc(char c);
+void con_puts(char *s);
+
+#endif
+/* EOF */
@@ -13,123 +13,459 @@
  * with this program, see LICENSE.md file for more details.
  * This program is distributed WITHOUT ANY WARRANTY.
  */
+#include "gpio.h"
 #include "hardware.h"
 #include "display.h"
-#include "display_font.h"
+#include "display_font_prop.h"
+#include "fmt.h"
+#include "prof.h"
+#include "timer.h"
 #include "types.h"
 #include "uart.h"
 
 #define SPI_DISP SERCOM0_ADDR
+#define DMA_DISP 0
 
-static void disp_cmd(u8 *cmd, int len);
-static void disp_dc(uint mode);
+/* Generic clock generators usable by SPI, and their frequency */
+#define SPI_GCLK_FAST  7         /* DFLL48M */
+#define SPI_FREQ_FAST  48000000
+#define SPI_GCLK_SLOW  1         /* OSC8M   */
+#define SPI_FREQ_SLOW  8000000
+/* Target SCK frequency (max for display: 10MHz, 100ns clock cycle) */
+#define SPI_FREQ       10000000
+/* Baudrate value, fSCK = fGCLK / (2 * (BAUD + 1)) rounded to stay below */
+#define SPI_BAUD(f)  ((((f) + (2 * SPI_FREQ) - 1) / (2 * SPI_FREQ)) - 1)
+/* Real SCK frequency obtained with this baudrate */
+#define SPI_REAL(f)  ((f) / (2 * (SPI_BAUD(f) + 1)))
+
+#if (SPI_BAUD(SPI_FREQ_FAST) < 0) || (SPI_BAUD(SPI_FREQ_FAST) > 255) || \
+    (SPI_BAUD(SPI_FREQ_SLOW) < 0) || (SPI_BAUD(SPI_FREQ_SLOW) > 255)
+#error "SPI baudrate can not be reached with this GCLK"
+#endif
+#if (SPI_REAL(SPI_FREQ_FAST) > SPI_FREQ) || (SPI_REAL(SPI_FREQ_SLOW) > SPI_FREQ)
+#error "SPI baudrate above target frequency"
+#endif
+
+/* Width of glyphs without any pixel (space) */
+#define DISP_FONT_SPACE 3
+
+/* Cost (in bytes) of one more window: address commands and DC cycles */
+#define DISP_WIN_COST 12
+/* Size of the transaction queue (number of runs and command bytes) */
+#define DISP_TX_RUNS 24
+#define DISP_TX_CMD  64
+
+/* DMAC transfer descriptor (see datasheet 20.10.1) */
+struct dma_desc
+{
+	u16 btctrl;
+	u16 btcnt;
+	u32 srcaddr;
+	u32 dstaddr;
+	u32 descaddr;
+};
+
+/* One run of bytes, sent with the same state of D/C pin */
+struct disp_run
+{
+	const u8 *buf;
+	u16 len;
+	u16 mode;
+};
+
+static RAMFUNC void disp_col(u8 v);
+static RAMFUNC void disp_dc(uint mode);
+static void disp_flush_windows(void);
+static RAMFUNC void disp_wr(uint page, uint x, u8 v);
+static void disp_tx_begin(void);
+static int  disp_tx_cmd (const u8 *cmd,  uint len);
+static int  disp_tx_data(const u8 *data, uint len);
+static void disp_tx_end (void (*done)(void));
+static RAMFUNC void disp_tx_next(void);
+static void dma_init(void);
+static RAMFUNC void dma_block(struct dma_desc *desc, const u8 *buf, uint len,
+                              struct dma_desc *next);
+static RAMFUNC void dma_start(void);
+static void spi_clock(uint fast);
 static void spi_init(void);
 
-static void spi_cs(uint state);
-static void spi_wait(void);
-static void spi_wr(unsigned char v);
+static RAMFUNC void spi_cs(uint state);
+
+/* Shadow copy of the display RAM (one byte per column, 8 rows per page) */
+static u8 fb[DISP_PAGES][DISP_WIDTH];
+/* Range of modified columns for each page (clean when min > max) */
+static u8 fb_min[DISP_PAGES];
+static u8 fb_max[DISP_PAGES];
+/* Current text position (column in pixels, page) */
+static uint cur_x, cur_y;
+/* Display start line to set at next flush (bit 7 set when pending) */
+static u8 disp_start;
+/* Number of empty columns added after each glyph */
+static uint txt_spacing = 1;
+/* Scale factor of text (1 to 4) */
+static uint txt_scale = 1;
+
+/* Bit spreading tables, each bit of a nibble is repeated 2, 3 or 4 times */
+static const u16 txt_spread[3][16] = {
+	{ 0x0000, 0x0003, 0x000C, 0x000F, 0x0030, 0x0033, 0x003C, 0x003F,
+	  0x00C0, 0x00C3, 0x00CC, 0x00CF, 0x00F0, 0x00F3, 0x00FC, 0x00FF },
+	{ 0x0000, 0x0007, 0x0038, 0x003F, 0x01C0, 0x01C7, 0x01F8, 0x01FF,
+	  0x0E00, 0x0E07, 0x0E38, 0x0E3F, 0x0FC0, 0x0FC7, 0x0FF8, 0x0FFF },
+	{ 0x0000, 0x000F, 0x00F0, 0x00FF, 0x0F00, 0x0F0F, 0x0FF0, 0x0FFF,
+	  0xF000, 0xF00F, 0xF0F0, 0xF0FF, 0xFF00, 0xFF0F, 0xFFF0, 0xFFFF },
+};
+
+/* Transaction queue, and state of the transfer in progress */
+static struct disp_run tx_run[DISP_TX_RUNS];
+static u8   tx_cmd[DISP_TX_CMD];
+static uint tx_nrun;
+static uint tx_ncmd;
+static uint tx_pos;
+static volatile uint tx_busy;
+static void (*tx_done)(void);
+/* Current SCK frequency */
+static u32  spi_freq;
+
+/* DMAC descriptors and write-back area (must be 128bits aligned) */
+static struct dma_desc dma_desc[DMA_DISP + 1] __attribute__((aligned(16)));
+static struct dma_desc dma_wb  [DMA_DISP + 1] __attribute__((aligned(16)));
+/* Linked descriptors, used to send multiple runs in one DMA transfer */
+static struct dma_desc dma_link[DISP_TX_RUNS] __attribute__((aligned(16)));
+
+/* Initialization sequence of the display controller */
+static const u8 disp_init_seq[] = {
+	0xAE,       // Set Display Off
+	0xD5, 0x80, // Set Clock
+	0xA8, 0x3F, // Set Multiplex Ratio
+	0xD3, 0x00, // Set Display Offset
+	0x40,       // Set Display Start Line
+	0x8D, 0x14, // Configure Charge Pump
+	0xA0,       // Set Segment Remap
+	0xC0,       // Set COM output scan direction
+	0xDA, 0x12, // COM pins hardware configuration
+	0x81, 0xCF, // Set Contrast Control
+	0xD9, 0xF1, // Set precharge period
+	0xDB, 0x40, // Set VCOMH deselect level
+	0xA4,       // Set Entire Display On/Off
+	0x20, 0x00, // Set Adressing Mode : Horizontal
+};
 
 /**
  * @brief Initialize display module
  *
+ * The configuration commands, the clear of the whole display RAM and the
+ * "display on" command are sent as one single transaction.
  */
 void disp_init(void)
 {
-	int i;
+	uint p, c;
 
 	spi_init();
+	dma_init();
 
-	reg_wr(0x60000000 + 0x18, (1 << 03));
-	for (i = 0; i < 10000; i++)
-		asm volatile("nop");
+	// Release reset, and wait for the controller to be ready
+	gpio_set(GPIO(PIN_DISP_RST));
+	timer_delay_us(1000);
 
-	disp_cmd((u8 *)"\xAE", 1);     // Set Display Off
-	disp_cmd((u8 *)"\xD5\x80", 2); // Set Clock
-	disp_cmd((u8 *)"\xA8\x3F", 2); // Set Multiplex Ratio
-	disp_cmd((u8 *)"\xD3\x00", 2); // Set Display Offset
-	disp_cmd((u8 *)"\x40", 1);     // Set Display Start Line
-	disp_cmd((u8 *)"\x8D\x14", 2); // Configure Charge Pump
-	disp_cmd((u8 *)"\xA0", 1);     // Set Segment Remap
-	disp_cmd((u8 *)"\xC0", 1);     // Set COM output scan direction
-	disp_cmd((u8 *)"\xDA\22", 2);  // COM pins hardware configuration
-	disp_cmd((u8 *)"\x81\xCF", 2); // Set Contrast Control
-	disp_cmd((u8 *)"\xD9\xF1", 2); // Set precharge period
-	disp_cmd((u8 *)"\xDB\x40", 2); // Set VCOMH deselect level
-	disp_cmd((u8 *)"\xA4", 1);     // Set Entire Display On/Off
+	// Content of display RAM is unknown after reset, force a full refresh
+	for (p = 0; p < DISP_PAGES; p++)
+	{
+		for (c = 0; c < DISP_WIDTH; c++)
+			fb[p][c] = 0x00;
+		disp_mark(p, 0, DISP_WIDTH - 1);
+	}
 
-	disp_clear(0xFF);
-	disp_cmd((u8 *)"\x20\x02", 2); // Set Adressing Mode : Page
-	disp_cmd((u8 *)"\xAF", 1);     // Set Display On
+	disp_tx_begin();
+	disp_tx_cmd(disp_init_seq, sizeof(disp_init_seq));
+	disp_flush_windows();
+	disp_tx_cmd((const u8 *)"\xAF", 1); // Set Display On
+	disp_tx_end(0);
+	while(tx_busy)
+		;
 }
 
 /**
  * @brief Clear one or multiple lines of display
  *
+ * The framebuffer is updated, use disp_flush() to send it to the display.
+ *
  * @param lines Bitmask of the lines to clear (0xFF to clear all)
  */
 void disp_clear(unsigned char lines)
 {
-	int p, c;
+	uint p, c;
+	PROF_BEGIN(PROF_DISP_CLEAR);
 
-	for (p = 0; p < 8; p++)
+	for (p = 0; p < DISP_PAGES; p++)
 	{
 		if ((lines & (1 << p)) == 0)
 			continue;
 
-		// Select next page (line)
-		disp_pos(0, p);
 		// Clear content of one line (each column)
-		disp_dc(DISP_MODE_DATA);
-		spi_cs(1);
-		for (c = 0; c < 128; c++)
-			spi_wr(0x00);
-		spi_wait();
-		spi_cs(0);
+		for (c = 0; c < DISP_WIDTH; c++)
+			disp_wr(p, c, 0x00);
+	}
+	PROF_END(PROF_DISP_CLEAR);
+}
+
+/**
+ * @brief Apply a list of compressed modifications to the framebuffer
+ *
+ * The delta is a list of spans, each one updates a range of columns of one
+ * page. A span starts with a 3 bytes header followed by its data :
+ *  - byte 0 : encoding (bits 4-5, see DISP_DELTA_xxx) and page (bits 0-2)
+ *  - byte 1 : first column
+ *  - byte 2 : number of columns (1 to 128)
+ * Data depends on the encoding : RAW and XOR have one byte per column, FILL
+ * has one byte, RUNS has (count, value) pairs until all columns are set.
+ *
+ * Only columns with a new value are marked as modified, so the next flush
+ * sends the smallest possible windows. Spans are applied until the end of
+ * data or the first malformed one.
+ *
+ * @param data Pointer to the delta
+ * @param len  Length of the delta (in bytes)
+ * @return integer Zero on success, -1 if the delta is malformed
+ */
+int disp_delta(const u8 *data, uint len)
+{
+	const u8 *end = data + len;
+	uint page, x, n, cnt;
+	uint mode;
+
+	while (data < end)
+	{
+		if ((end - data) < 3)
+			return(-1);
+		mode = (data[0] >> 4) & 3;
+		page = (data[0] & 0x07);
+		x    = data[1];
+		n    = data[2];
+		data += 3;
+		if ((n == 0) || (x >= DISP_WIDTH) || (n > (DISP_WIDTH - x)))
+			return(-1);
+
+		switch(mode)
+		{
+			case DISP_DELTA_RAW:
+			case DISP_DELTA_XOR:
+				if ((uint)(end - data) < n)
+					return(-1);
+				for ( ; n; n--, x++, data++)
+				{
+					if (mode == DISP_DELTA_RAW)
+						disp_wr(page, x, *data);
+					else
+						disp_wr(page, x, fb[page][x] ^ *data);
+				}
+				break;
+
+			case DISP_DELTA_FILL:
+				if (data == end)
+					return(-1);
+				for ( ; n; n--, x++)
+					disp_wr(page, x, *data);
+				data++;
+				break;
+
+			case DISP_DELTA_RUNS:
+				while (n)
+				{
+					if ((end - data) < 2)
+						return(-1);
+					cnt = data[0];
+					if ((cnt == 0) || (cnt > n))
+						return(-1);
+					for (n -= cnt; cnt; cnt--, x++)
+						disp_wr(page, x, data[1]);
+					data += 2;
+				}
+				break;
+		}
+	}
+	return(0);
+}
+
+/**
+ * @brief Test if a flush is in progress
+ *
+ * @return integer Non-zero value if a flush is still in progress
+ */
+int disp_busy(void)
+{
+	return(tx_busy);
+}
+
+/**
+ * @brief Update SPI clock after a change of clock profile
+ *
+ * When DFLL48M is stopped, the SPI port uses OSC8M with a lower SCK
+ * frequency. A flush in progress is finished before the change.
+ *
+ * @param dfll Non-zero if DFLL48M (GCLK7) is running
+ */
+void disp_clock(uint dfll)
+{
+	while(tx_busy)
+		;
+	// Disable SPI (BAUD and GCLK can not be modified when enabled)
+	reg_wr(SPI_DISP + 0x00, reg_rd(SPI_DISP + 0x00) & ~(1 << 1));
+	while (reg_rd(SPI_DISP + 0x1C) & (1 << 1))
+		;
+	spi_clock(dfll);
+}
+
+/**
+ * @brief Get the real frequency of the SPI clock (SCK)
+ *
+ * @return u32 Frequency of SCK in Hz
+ */
+u32 disp_spi_freq(void)
+{
+	return(spi_freq);
+}
+
+/**
+ * @brief Send modified parts of the framebuffer to the display
+ *
+ * This function start the transfer (see disp_flush_async) and wait for the
+ * end of it.
+ */
+void disp_flush(void)
+{
+	PROF_BEGIN(PROF_DISP_FLUSH);
+
+	// Wait end of previous transfer
+	while(tx_busy)
+		;
+	disp_flush_async(0);
+	// Wait end of this transfer
+	while(tx_busy)
+		;
+	PROF_END(PROF_DISP_FLUSH);
+}
+
+/**
+ * @brief Start sending modified parts of the framebuffer to the display
+ *
+ * Only the pages that have been modified since last flush are sent, and for
+ * each of them only the range of columns between the first and the last
+ * modified one. Consecutive pages are grouped into windows (see
+ * disp_flush_windows) and all windows are sent into one transaction. The
+ * transfer is made by DMA, this function returns as soon as it has been
+ * started. Drawing functions can still be used during the flush, modified
+ * columns will be sent by the next one.
+ *
+ * @param done Function called (from interrupt) at the end of the flush
+ * @return integer Zero on success, -1 if a flush is already in progress
+ */
+int disp_flush_async(void (*done)(void))
+{
+	u8 cmd;
+
+	if (tx_busy)
+		return(-1);
+
+	disp_tx_begin();
+	disp_flush_windows();
+	// Update start line after the content, to scroll on new data
+	if (disp_start & 0x80)
+	{
+		cmd = 0x40 | (disp_start & 0x3F); // Set Display Start Line
+		disp_tx_cmd(&cmd, 1);
+		disp_start = 0;
 	}
+	disp_tx_end(done);
+	return(0);
+}
+
+/**
+ * @brief Set the display RAM line shown on top of the screen
+ *
+ * This allows to scroll the whole screen without any transfer of the
+ * content : only the "start line" register of the controller is modified.
+ * The new value is sent with the next flush, after the modified content.
+ *
+ * @param line Index of the RAM line (0 to 63) to show on top
+ */
+void disp_scroll(uint line)
+{
+	disp_start = 0x80 | (line & 0x3F);
 }
 
 /**
- * @brief Set the current address into display RAM
+ * @brief Get a pointer to one page of the framebuffer
+ *
+ * This is used by drawing modules (see gfx.c) to access framebuffer content
+ * directly. Modified columns must be reported with disp_mark().
+ *
+ * @param page Index of the page
+ * @return u8* Pointer to the first column of the page
+ */
+u8 *disp_fb(uint page)
+{
+	return(fb[page]);
+}
+
+/**
+ * @brief Add a range of columns to the modified area of a page
+ *
+ * @param page Index of the page
+ * @param x0   First modified column
+ * @param x1   Last modified column
+ */
+RAMFUNC void disp_mark(uint page, uint x0, uint x1)
+{
+	if (x0 < fb_min[page])
+		fb_min[page] = x0;
+	if (x1 > fb_max[page])
+		fb_max[page] = x1;
+}
+
+/**
+ * @brief Set the current text position
  *
  * @param x Specify the horitontal position (multiplied by 8)
  * @param y Specify the current page
  */
 void disp_pos(uint x, uint y)
 {
-	u8 cmd[3];
-
-	// Set Adressing Mode : Page Adressing
-	disp_cmd((u8 *)"\x20\x02", 2);
-	// Set current page : 0xB0 + y
-	cmd[0] = 0xB0 + y;
-	disp_cmd((u8 *)cmd, 1);
-	// Set lower column start address
-	cmd[0] = 0x21;     /* Command */
-	cmd[1] = (x << 3); /* Start   */
-	cmd[2] = 0x7F;     /* End     */
-	disp_cmd((u8 *)cmd, 3);
+	cur_x = (x << 3);
+	cur_y = (y & (DISP_PAGES - 1));
 }
 
 /**
  * @brief Draw a character at current position
  *
+ * The glyph is written into the framebuffer, use disp_flush() to send it to
+ * the display. Glyphs are proportional : only the used columns of the glyph
+ * are drawn, followed by the configured spacing (see disp_spacing).
+ *
  * @param c Character do display (to draw)
  */
-void disp_putc(char c)
+RAMFUNC void disp_putc(char c)
 {
-	int index;
-	int i;
+	const u8 *cols;
+	uint idx, w;
+	uint i;
 
-	if (c & 0x80)
+	if ((c & 0x80) || (c < 0x20))
 		return;
 
-	disp_dc(DISP_MODE_DATA);
-	index = (c - 0x20);
-	spi_cs(1);
-	for (i = 0; i < 8; i++)
-		spi_wr( font[index][i] );
-	spi_wait();
-	spi_cs(0);
+	idx  = font_idx[c - 0x20];
+	cols = &font_cols[idx >> 4];
+	w    = (idx & 0x0F);
+
+	// Glyph without any pixel (space)
+	if (w == 0)
+	{
+		for (i = 0; i < DISP_FONT_SPACE; i++)
+			disp_col(0x00);
+	}
+	for (i = 0; i < w; i++)
+		disp_col(cols[i]);
+	for (i = 0; i < txt_spacing; i++)
+		disp_col(0x00);
 }
 
 /**
@@ -139,10 +475,75 @@ void disp_putc(char c)
  */
 void disp_puts(char *s)
 {
+	PROF_BEGIN(PROF_DISP_PUTS);
+
 	while(*s)
 	{
 		disp_putc(*s++);
 	}
+	PROF_END(PROF_DISP_PUTS);
+}
+
+/**
+ * @brief Display a formatted text-string at current position
+ *
+ * @param fmt Format string (see fmt_vprint for supported conversions)
+ * @return integer Number of characters drawn
+ */
+int disp_printf(const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = fmt_vprint(disp_putc, fmt, ap);
+	va_end(ap);
+	return(len);
+}
+
+/**
+ * @brief Set the scale factor used to draw text
+ *
+ * With a scale factor of N, each pixel of the font is drawn as a NxN block.
+ * The text then uses N pages, starting at the current one (see disp_pos).
+ *
+ * @param n Scale factor (1 to 4)
+ */
+void disp_scale(uint n)
+{
+	if ((n < 1) || (n > 4))
+		return;
+	txt_scale = n;
+}
+
+/**
+ * @brief Set the number of empty columns between two characters
+ *
+ * @param n Number of columns (pixels)
+ */
+void disp_spacing(uint n)
+{
+	txt_spacing = n;
+}
+
+/**
+ * @brief Compute the width of a text-string, using the current spacing
+ *
+ * @param s Pointer to the nul terminated text-string
+ * @return uint Width of the text in pixels
+ */
+uint disp_width(char *s)
+{
+	uint w, n;
+
+	for (n = 0; *s; s++)
+	{
+		if ((*s & 0x80) || (*s < 0x20))
+			continue;
+		w = (font_idx[*s - 0x20] & 0x0F);
+		n += (w ? w : DISP_FONT_SPACE) + txt_spacing;
+	}
+	return(n * txt_scale);
 }
 
 /**
@@ -157,11 +558,8 @@ void disp_test(int type)
 	// Pattern test
 	if (type == 0)
 	{
-		spi_cs(1);
-		for (i = 0; i < 128; i++)
-			spi_wr(i);
-		spi_wait();
-		spi_cs(0);
+		for (i = 0; i < DISP_WIDTH; i++)
+			disp_wr(cur_y, i, i);
 	}
 }
 
@@ -170,26 +568,44 @@ void disp_test(int type)
 /* -------------------------------------------------------------------------- */
 
 /**
- * @brief Send a command to the display
+ * @brief Write one column at current text position, and move to next one
+ *
+ * When a scale factor is set, the column is first enlarged vertically using
+ * the bit spreading tables (one nibble at a time), then written as many times
+ * as the scale factor, on as many pages.
  *
- * @param cmd Pointer to an array with all bytes of the command
- * @param len NUmber of bytes to send
+ * @param v Value of the column (one bit per row)
  */
-static void disp_cmd(u8 *cmd, int len)
+static RAMFUNC void disp_col(u8 v)
 {
-	// Set D/C pin to "command" mode
-	disp_dc(DISP_MODE_CMD);
+	const u16 *lut;
+	uint i, p;
+	u32 col;
 
-	// Send specified number of bytes
-	spi_cs(1);
-	while(len)
+	if (txt_scale == 1)
+	{
+		if (cur_x >= DISP_WIDTH)
+			return;
+		disp_wr(cur_y, cur_x, v);
+		cur_x++;
+		return;
+	}
+
+	lut = txt_spread[txt_scale - 2];
+	col = lut[v & 0x0F] | ((u32)lut[v >> 4] << (txt_scale << 2));
+
+	for (i = 0; i < txt_scale; i++)
 	{
-		spi_wr(*cmd);
-		cmd++;
-		len--;
+		if (cur_x >= DISP_WIDTH)
+			return;
+		for (p = 0; p < txt_scale; p++)
+		{
+			if ((cur_y + p) >= DISP_PAGES)
+				break;
+			disp_wr(cur_y + p, cur_x, (col >> (p << 3)));
+		}
+		cur_x++;
 	}
-	spi_wait();
-	spi_cs(0);
 }
 
 /**
@@ -197,12 +613,350 @@ static void disp_cmd(u8 *cmd, int len)
  *
  * @param mode New mode to set to the pin
  */
-static void disp_dc(uint mode)
+static RAMFUNC void disp_dc(uint mode)
 {
 	if (mode == DISP_MODE_CMD)
-		reg_wr(PORT_ADDR + 0x14, (1 << 2)); // D/C = 0
+		gpio_clr(GPIO(PIN_DISP_DC)); // D/C = 0
 	else
-		reg_wr(PORT_ADDR + 0x18, (1 << 2)); // D/C = 1
+		gpio_set(GPIO(PIN_DISP_DC)); // D/C = 1
+}
+
+/**
+ * @brief Add modified parts of the framebuffer to current transaction
+ *
+ * The display is used in horizontal addressing mode : for each window, the
+ * commands to set columns and pages are added, followed by the content of
+ * the window. A window starts on the next modified page, and following pages
+ * are added as long as sending them into the same (larger) window costs less
+ * than a separate one.
+ */
+static void disp_flush_windows(void)
+{
+	uint x0, x1, p0, p1, p, q;
+	uint len;
+	u8 cmd[6];
+
+	for (p = 0; p < DISP_PAGES; p = p1 + 1)
+	{
+		p1 = p;
+		// Nothing to do for this page
+		if (fb_min[p] > fb_max[p])
+			continue;
+
+		p0 = p;
+		cmd[1] = fb_min[p];
+		cmd[2] = fb_max[p];
+		// Try to extend the window with next modified pages
+		for (q = p1 + 1; q < DISP_PAGES; q++)
+		{
+			if (fb_min[q] > fb_max[q])
+				continue;
+			x0 = (fb_min[q] < cmd[1]) ? fb_min[q] : cmd[1];
+			x1 = (fb_max[q] > cmd[2]) ? fb_max[q] : cmd[2];
+			// Cost of current window plus a new one for page q ...
+			len  = (p1 - p0 + 1) * (cmd[2] - cmd[1] + 1);
+			len += (fb_max[q] - fb_min[q] + 1) + DISP_WIN_COST;
+			// ... compared to a window including page q
+			if ((q - p0 + 1) * (x1 - x0 + 1) > len)
+				break;
+			p1 = q;
+			cmd[1] = x0;
+			cmd[2] = x1;
+		}
+
+		cmd[0] = 0x21; // Set column address (start, end)
+		cmd[3] = 0x22; // Set page address (start, end)
+		cmd[4] = p0;
+		cmd[5] = p1;
+		if (disp_tx_cmd(cmd, 6) < 0)
+			return;
+		// Add content of each page, contiguous pages are merged
+		len = (cmd[2] - cmd[1] + 1);
+		for (q = p0; q <= p1; q++)
+		{
+			if (disp_tx_data(&fb[q][cmd[1]], len) < 0)
+				return;
+			// Page will be sent, mark it as clean
+			fb_min[q] = DISP_WIDTH;
+			fb_max[q] = 0;
+		}
+	}
+}
+
+/**
+ * @brief Write one column byte into the framebuffer
+ *
+ * The column is marked as modified only when the new value differs from the
+ * current framebuffer content.
+ *
+ * @param page Index of the page
+ * @param x    Index of the column
+ * @param v    New value of the column (one bit per row)
+ */
+static RAMFUNC void disp_wr(uint page, uint x, u8 v)
+{
+	if (fb[page][x] == v)
+		return;
+	fb[page][x] = v;
+	disp_mark(page, x, x);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                         Transaction  builder                         -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Start a new transaction
+ *
+ * A transaction is a list of runs of command or data bytes. The whole
+ * transaction is sent with CS asserted, D/C pin is updated only between two
+ * runs of different types. If a previous transaction is still in progress,
+ * this function wait for the end of it.
+ */
+static void disp_tx_begin(void)
+{
+	while(tx_busy)
+		;
+	tx_nrun = 0;
+	tx_ncmd = 0;
+}
+
+/**
+ * @brief Add command bytes to the current transaction
+ *
+ * Command bytes are copied into the transaction buffer, so the caller can
+ * use a temporary buffer. Consecutive commands are merged into one run.
+ *
+ * @param cmd Pointer to the command bytes
+ * @param len Number of bytes
+ * @return integer Zero on success, -1 if the transaction is full
+ */
+static int disp_tx_cmd(const u8 *cmd, uint len)
+{
+	struct disp_run *run;
+	uint i;
+
+	if ((tx_ncmd + len) > DISP_TX_CMD)
+		return(-1);
+
+	run = (tx_nrun > 0) ? &tx_run[tx_nrun - 1] : 0;
+	// Previous run is not a command, start a new one
+	if ((run == 0) || (run->mode != DISP_MODE_CMD))
+	{
+		if (tx_nrun == DISP_TX_RUNS)
+			return(-1);
+		run = &tx_run[tx_nrun++];
+		run->buf  = &tx_cmd[tx_ncmd];
+		run->len  = 0;
+		run->mode = DISP_MODE_CMD;
+	}
+	for (i = 0; i < len; i++)
+		tx_cmd[tx_ncmd++] = cmd[i];
+	run->len += len;
+	return(0);
+}
+
+/**
+ * @brief Add data bytes to the current transaction
+ *
+ * Data bytes are NOT copied, the buffer must stay valid until the end of the
+ * transfer. When the buffer follows the previous data run into memory, both
+ * are merged.
+ *
+ * @param data Pointer to the data bytes
+ * @param len  Number of bytes
+ * @return integer Zero on success, -1 if the transaction is full
+ */
+static int disp_tx_data(const u8 *data, uint len)
+{
+	struct disp_run *run;
+
+	run = (tx_nrun > 0) ? &tx_run[tx_nrun - 1] : 0;
+	if ((run != 0) && (run->mode == DISP_MODE_DATA) &&
+	    ((run->buf + run->len) == data))
+	{
+		run->len += len;
+		return(0);
+	}
+	if (tx_nrun == DISP_TX_RUNS)
+		return(-1);
+	run = &tx_run[tx_nrun++];
+	run->buf  = data;
+	run->len  = len;
+	run->mode = DISP_MODE_DATA;
+	return(0);
+}
+
+/**
+ * @brief Start sending the current transaction
+ *
+ * @param done Function called (from interrupt) at the end of the transfer
+ */
+static void disp_tx_end(void (*done)(void))
+{
+	tx_done = done;
+	tx_pos  = 0;
+	// Empty transaction, nothing to send
+	if (tx_nrun == 0)
+	{
+		if (done)
+			done();
+		return;
+	}
+	tx_busy = 1;
+	spi_cs(1);
+	disp_tx_next();
+}
+
+/**
+ * @brief Start the transfer of the next runs of the current transaction
+ *
+ * This function is called at the start of a transaction, then by the SPI
+ * interrupt at the end of each transfer (when all bytes has been shifted out
+ * so the D/C pin can be modified). All the consecutive runs of the same type
+ * are sent into one DMA transfer, using linked descriptors.
+ */
+static RAMFUNC void disp_tx_next(void)
+{
+	struct dma_desc *desc, *next;
+	uint mode, n;
+
+	// All runs sent, transaction complete
+	if (tx_pos == tx_nrun)
+	{
+		spi_cs(0);
+		tx_busy = 0;
+		if (tx_done)
+			tx_done();
+		return;
+	}
+
+	mode = tx_run[tx_pos].mode;
+	disp_dc(mode);
+
+	desc = &dma_desc[DMA_DISP];
+	for (n = 0; tx_pos < tx_nrun; n++)
+	{
+		if (((tx_pos + 1) < tx_nrun) && (tx_run[tx_pos + 1].mode == mode))
+			next = &dma_link[n];
+		else
+			next = 0;
+		dma_block(desc, tx_run[tx_pos].buf, tx_run[tx_pos].len, next);
+		tx_pos++;
+		if (next == 0)
+			break;
+		desc = next;
+	}
+	dma_start();
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                            DMA  functions                            -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Initialize the DMA controller and the channel used for display
+ *
+ */
+static void dma_init(void)
+{
+	// Enable DMAC clocks (AHBMASK and APBBMASK)
+	reg_set(PM_ADDR + 0x14, (1 << 5));
+	reg_set(PM_ADDR + 0x1C, (1 << 4));
+
+	// Reset DMAC
+	reg16_wr(DMAC_ADDR + 0x00, 0x0000);
+	reg16_wr(DMAC_ADDR + 0x00, 0x0001);
+	while (reg16_rd(DMAC_ADDR + 0x00) & 0x0001)
+		;
+	// Set address of descriptors and write-back memory sections
+	reg_wr(DMAC_ADDR + 0x34, (u32)dma_desc);
+	reg_wr(DMAC_ADDR + 0x38, (u32)dma_wb);
+	// Enable DMAC, with priority level 0
+	reg16_wr(DMAC_ADDR + 0x00, (1 << 8) | (1 << 1));
+
+	// Select channel and reset it
+	reg8_wr(DMAC_ADDR + 0x3F, DMA_DISP);
+	reg8_wr(DMAC_ADDR + 0x40, 0x01);
+	while (reg8_rd(DMAC_ADDR + 0x40) & 0x01)
+		;
+	// Configure channel: trigger on SERCOM0 TX, one beat per trigger
+	reg_wr(DMAC_ADDR + 0x44, (2 << 22) | (0x02 << 8));
+	// Enable Transfer Complete and Transfer Error interrupts
+	reg8_wr(DMAC_ADDR + 0x4D, 0x03);
+
+	// Enable DMAC and SERCOM0 interrupts into NVIC
+	reg_wr(NVIC_ADDR + 0x00, (1 << 6) | (1 << 9));
+}
+
+/**
+ * @brief Configure a DMA block transfer from a buffer to the SPI port
+ *
+ * @param desc Pointer to the descriptor to configure
+ * @param buf  Pointer to the data to send
+ * @param len  Number of bytes to send
+ * @param next Pointer to the descriptor of the next block (or NULL)
+ */
+static RAMFUNC void dma_block(struct dma_desc *desc, const u8 *buf, uint len,
+                              struct dma_desc *next)
+{
+	desc->btctrl   = (1 << 10) | /* SRCINC: increment source address */
+	                 (1 <<  0);  /* VALID                            */
+	// Interrupt at the end of the last block
+	if (next == 0)
+		desc->btctrl |= (1 << 3); /* BLOCKACT: interrupt */
+	desc->btcnt    = len;
+	desc->srcaddr  = (u32)buf + len; /* End address of the block */
+	desc->dstaddr  = SPI_DISP + 0x28;
+	desc->descaddr = (u32)next;
+}
+
+/**
+ * @brief Start the DMA transfer configured into channel descriptor(s)
+ *
+ */
+static RAMFUNC void dma_start(void)
+{
+	// Clear TXC flag of previous transfer
+	reg8_wr(SPI_DISP + 0x18, 0x02);
+	// Enable the channel, transfer is started by SERCOM TX trigger
+	reg8_wr(DMAC_ADDR + 0x3F, DMA_DISP);
+	reg8_wr(DMAC_ADDR + 0x40, 0x02);
+}
+
+/**
+ * @brief DMAC interrupt handler
+ *
+ * Called when all bytes of a buffer have been pushed to the SPI port. The
+ * last bytes are still into the SPI shift register, so the end of transfer
+ * is processed by SPI interrupt (on TXC).
+ */
+RAMFUNC void DMAC_Handler(void)
+{
+	u8 flags;
+
+	reg8_wr(DMAC_ADDR + 0x3F, DMA_DISP);
+	flags = reg8_rd(DMAC_ADDR + 0x4E);
+	reg8_wr(DMAC_ADDR + 0x4E, flags);
+
+	// Enable SPI Transmit Complete interrupt
+	if (flags & 0x03)
+		reg8_wr(SPI_DISP + 0x16, 0x02);
+}
+
+/**
+ * @brief SERCOM0 (display SPI) interrupt handler
+ *
+ */
+RAMFUNC void SERCOM0_Handler(void)
+{
+	if ((reg8_rd(SPI_DISP + 0x18) & 0x02) == 0)
+		return;
+
+	// Disable TXC interrupt
+	reg8_wr(SPI_DISP + 0x14, 0x02);
+	// Continue with next runs
+	disp_tx_next();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -214,12 +968,37 @@ static void disp_dc(uint mode)
  *
  * @param state Positive value to activate CS (set to 0), Zero to desactivate
  */
-static void spi_cs(uint state)
+static RAMFUNC void spi_cs(uint state)
 {
 	if (state)
-		reg_wr(PORT_ADDR + 0x14, (1 << 6)); // Set CS=0 to "start"
+		gpio_clr(GPIO(PIN_DISP_NSS)); // Set CS=0 to "start"
+	else
+		gpio_set(GPIO(PIN_DISP_NSS)); // Set CS=1 to "stop"
+}
+
+/**
+ * @brief Select the GCLK and baudrate of SPI, then enable it
+ *
+ * @param fast Non-zero to use DFLL48M (GCLK7), else OSC8M (GCLK1)
+ */
+static void spi_clock(uint fast)
+{
+	if (fast)
+	{
+		gclk_select(0x14, SPI_GCLK_FAST);
+		reg8_wr(SPI_DISP + 0x0C, SPI_BAUD(SPI_FREQ_FAST));
+		spi_freq = SPI_REAL(SPI_FREQ_FAST);
+	}
 	else
-		reg_wr(PORT_ADDR + 0x18, (1 << 6)); // Set CS=1 to "stop"
+	{
+		gclk_select(0x14, SPI_GCLK_SLOW);
+		reg8_wr(SPI_DISP + 0x0C, SPI_BAUD(SPI_FREQ_SLOW));
+		spi_freq = SPI_REAL(SPI_FREQ_SLOW);
+	}
+	// Set ENABLE into CTRLA
+	reg_set(SPI_DISP + 0x00, (1 << 1));
+	while (reg_rd(SPI_DISP + 0x1C) & (1 << 1))
+		;
 }
 
 /**
@@ -230,9 +1009,6 @@ static void spi_init(void)
 {
 	// Enable SERCOM0 clock (APBCMASK)
 	reg_set(PM_ADDR + 0x20, (1 << 2));
-	// Set GCLK for SERCOM0 (generic clock generator 1)
-	reg16_wr (GCLK_ADDR + 0x02, (1 << 14) | (1 << 8) | 0x14);
-
 	// Reset SPI (set SWRST)
 	reg_wr((SPI_DISP + 0x00), 0x01);
 	// Wait end of software reset
@@ -245,35 +1021,7 @@ static void spi_init(void)
 	                        (3 << 2));  // SPI host
 	// Set RXEN
 	reg_wr(SPI_DISP + 0x04, (1 << 17));
-	// Configure Baudrate (Max freq for display: 10MHz)
-	reg8_wr(SPI_DISP + 0x0C, 8);
-
-	// Set ENABLE into CTRLA
-	reg_set(SPI_DISP + 0x00, (1 << 1));
-}
-
-/**
- * @brief Wait the end of current transfer (mainly for CS synchronization)
- *
- */
-static void spi_wait(void)
-{
-	// Wait for Transmit Complete flag
-	while((reg8_rd(SPI_DISP + 0x18) & 2) == 0)
-		;
-}
-
-/**
- * @brief Push one single byte to the SPI tx fifo
- *
- * @param v Value to send
- */
-static void spi_wr(unsigned char v)
-{
-	// Wait Data Register Empty
-	while((reg8_rd(SPI_DISP + 0x18) & 1) == 0)
-		;
-	// Push data byte to send
-	reg16_wr(SPI_DISP + 0x28, v);
+	// Configure GCLK and Baudrate (see SPI_FREQ), then enable
+	spi_clock(1);
 }
 /* EOF */
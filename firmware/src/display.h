@@ -15,15 +15,40 @@
  */
 #ifndef DISPLAY_H
 #define DISPLAY_H
+#include "hardware.h"
+#include "types.h"
 
 #define DISP_MODE_CMD  0
 #define DISP_MODE_DATA 1
 
+#define DISP_WIDTH  128
+#define DISP_HEIGHT  64
+#define DISP_PAGES    8
+
+/* Encoding of a delta span (see disp_delta) */
+#define DISP_DELTA_RAW  0 /* Columns are written                     */
+#define DISP_DELTA_FILL 1 /* One value is written into all columns   */
+#define DISP_DELTA_XOR  2 /* Columns are XORed with current content  */
+#define DISP_DELTA_RUNS 3 /* List of (count, value) runs are written */
+
 void disp_init(void);
 void disp_clear(unsigned char lines);
+int  disp_delta(const u8 *data, unsigned int len);
+void disp_flush(void);
+int  disp_flush_async(void (*done)(void));
+int  disp_busy(void);
+void disp_clock(unsigned int dfll);
+u32  disp_spi_freq(void);
+u8  *disp_fb(unsigned int page);
+RAMFUNC void disp_mark(unsigned int page, unsigned int x0, unsigned int x1);
 void disp_pos(unsigned int x, unsigned int y);
-void disp_putc(char c);
+void disp_scroll(unsigned int line);
+RAMFUNC void disp_putc(char c);
 void disp_puts(char *s);
+int  disp_printf(const char *fmt, ...);
+void disp_scale(unsigned int n);
+void disp_spacing(unsigned int n);
+unsigned int disp_width(char *s);
 
 void disp_test(int type);
 
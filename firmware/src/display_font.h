@@ -2,6 +2,9 @@
  * @file  display_font.h
  * @brief Bitmap of the default 8x8 text font
  *
+ * This table is the source of the proportional font used by the display
+ * driver (see scripts/fontgen.py), it is not compiled into the firmware.
+ *
  * @author Saint-Genest Gwenael <gwen@cowlab.fr>
  * @copyright Agilack (c) 2022
  *
@@ -0,0 +1,291 @@
+/**
+ * @file  fmt.c
+ * @brief Formatted output (small printf-like functions)
+ *
+ * Characters are sent one by one to a "put" function (uart, display, ...)
+ * so no output buffer is needed. Cortex-M0+ has no hardware divider and the
+ * firmware is not linked with libgcc : decimal conversion uses a division
+ * by 10 made with shifts, additions and one multiply (see fmt_divu10).
+ *
+ * Supported conversions : %c %s %d %i %u %x %X %q %% with flags '-' (left
+ * aligned) and '0' (zero padding), a field width and a precision. The 'l'
+ * modifier is accepted (int and long have the same size). %q prints a
+ * signed 16.16 fixed point value with "precision" decimals (0 to 4,
+ * default is 2).
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "fmt.h"
+
+#define FMT_LEFT 0x01
+#define FMT_ZERO 0x02
+
+/* Max number of decimals for %q (16 bits of fraction) */
+#define FMT_Q_PREC 4
+
+static char *fmt_dec(char *end, u32 v);
+static int   fmt_pad(void (*put)(char c), char c, uint width, uint len);
+
+/* Half of the last printed decimal, for rounding of %q (in 1/65536) */
+static const u16 fmt_round[FMT_Q_PREC + 1] = { 32768, 3277, 328, 33, 3 };
+static const char fmt_hex[16] = "0123456789ABCDEF";
+
+/**
+ * @brief Print a formatted string
+ *
+ * @param put Function called for each output character
+ * @param fmt Format string (see fmt_vprint)
+ * @return integer Number of characters sent
+ */
+int fmt_print(void (*put)(char c), const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = fmt_vprint(put, fmt, ap);
+	va_end(ap);
+	return(len);
+}
+
+/**
+ * @brief Print a formatted string (with a list of arguments)
+ *
+ * @param put Function called for each output character
+ * @param fmt Format string
+ * @param ap  List of arguments
+ * @return integer Number of characters sent
+ */
+int fmt_vprint(void (*put)(char c), const char *fmt, va_list ap)
+{
+	char  buf[20];
+	const char *s;
+	char *p;
+	char  sign;
+	uint  flags, width, prec, len, total, lower;
+	u32   v;
+	int   count = 0;
+
+	for ( ; *fmt; fmt++)
+	{
+		if (*fmt != '%')
+		{
+			put(*fmt);
+			count++;
+			continue;
+		}
+		fmt++;
+
+		/* Flags */
+		flags = 0;
+		for ( ; ; fmt++)
+		{
+			if (*fmt == '-')
+				flags |= FMT_LEFT;
+			else if (*fmt == '0')
+				flags |= FMT_ZERO;
+			else
+				break;
+		}
+		/* Field width */
+		width = 0;
+		for ( ; (*fmt >= '0') && (*fmt <= '9'); fmt++)
+			width = (width * 10) + (*fmt - '0');
+		/* Precision */
+		prec = 2;
+		if (*fmt == '.')
+		{
+			prec = 0;
+			for (fmt++; (*fmt >= '0') && (*fmt <= '9'); fmt++)
+				prec = (prec * 10) + (*fmt - '0');
+		}
+		if (*fmt == 'l')
+			fmt++;
+
+		/* Numbers are written backward, ending at buf[11] */
+		sign = 0;
+		p    = buf + 11;
+		switch(*fmt)
+		{
+			case 'c':
+				buf[0] = (char)va_arg(ap, int);
+				s   = buf;
+				len = 1;
+				break;
+
+			case 's':
+				s = va_arg(ap, const char *);
+				if (s == 0)
+					s = "(null)";
+				for (len = 0; s[len]; len++)
+					;
+				break;
+
+			case 'd':
+			case 'i':
+			case 'u':
+				v = va_arg(ap, u32);
+				if ((*fmt != 'u') && ((s32)v < 0))
+				{
+					sign = '-';
+					v = -v;
+				}
+				s   = fmt_dec(p, v);
+				len = p - s;
+				break;
+
+			case 'x':
+			case 'X':
+				v = va_arg(ap, u32);
+				lower = (*fmt == 'x') ? 0x20 : 0x00;
+				do
+				{
+					*--p = fmt_hex[v & 0x0F] | lower;
+					v >>= 4;
+				} while (v);
+				s   = p;
+				len = (buf + 11) - p;
+				break;
+
+			case 'q':
+				v = va_arg(ap, u32);
+				if ((s32)v < 0)
+				{
+					sign = '-';
+					v = -v;
+				}
+				if (prec > FMT_Q_PREC)
+					prec = FMT_Q_PREC;
+				v += fmt_round[prec];
+				/* Integer part */
+				s = fmt_dec(p, v >> 16);
+				/* Decimals : fraction multiplied by 10 for each digit */
+				if (prec)
+				{
+					*p++ = '.';
+					for (v &= 0xFFFF; prec; prec--)
+					{
+						v *= 10;
+						*p++ = '0' + (v >> 16);
+						v &= 0xFFFF;
+					}
+				}
+				len = p - s;
+				break;
+
+			case '%':
+				s   = "%";
+				len = 1;
+				break;
+
+			case 0:
+				return(count);
+
+			default:
+				/* Unknown conversion, print it as is */
+				put('%');
+				put(*fmt);
+				count += 2;
+				continue;
+		}
+
+		total = sign ? (len + 1) : len;
+		if ((flags & (FMT_LEFT | FMT_ZERO)) == 0)
+			count += fmt_pad(put, ' ', width, total);
+		if (sign)
+			put(sign);
+		if ((flags & (FMT_LEFT | FMT_ZERO)) == FMT_ZERO)
+			count += fmt_pad(put, '0', width, total);
+		for ( ; len; len--)
+			put(*s++);
+		if (flags & FMT_LEFT)
+			count += fmt_pad(put, ' ', width, total);
+		count += total;
+	}
+	return(count);
+}
+
+/**
+ * @brief Divide an unsigned integer by 10
+ *
+ * The quotient is first estimated by multiplying by 0.8 (shifts and adds,
+ * see "Hacker's Delight" 10-17) then divided by 8. The estimate can be too
+ * small by one, this is fixed using the remainder.
+ *
+ * @param v Value to divide
+ * @param r Pointer to a variable where remainder is stored
+ * @return u32 Quotient of v / 10
+ */
+u32 fmt_divu10(u32 v, uint *r)
+{
+	u32 q, t;
+
+	q  = (v >> 1) + (v >> 2);
+	q += (q >> 4);
+	q += (q >> 8);
+	q += (q >> 16);
+	q >>= 3;
+	t  = v - ((q << 3) + (q << 1));
+	if (t > 9)
+	{
+		q++;
+		t -= 10;
+	}
+	*r = t;
+	return(q);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Convert an unsigned integer to decimal digits
+ *
+ * Digits are written backward, from the end of the buffer.
+ *
+ * @param end Pointer after the last digit
+ * @param v   Value to convert
+ * @return char* Pointer to the first digit
+ */
+static char *fmt_dec(char *end, u32 v)
+{
+	uint r;
+
+	do
+	{
+		v = fmt_divu10(v, &r);
+		*--end = '0' + r;
+	} while (v);
+	return(end);
+}
+
+/**
+ * @brief Send padding characters
+ *
+ * @param put   Function called for each output character
+ * @param c     Padding character
+ * @param width Field width
+ * @param len   Length of the field content
+ * @return integer Number of characters sent
+ */
+static int fmt_pad(void (*put)(char c), char c, uint width, uint len)
+{
+	int count = 0;
+
+	for ( ; width > len; width--, count++)
+		put(c);
+	return(count);
+}
+/* EOF */
@@ -0,0 +1,26 @@
+/**
+ * @file  fmt.h
+ * @brief Definitions and prototypes for formatted output
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef FMT_H
+#define FMT_H
+#include <stdarg.h>
+#include "types.h"
+
+int fmt_print (void (*put)(char c), const char *fmt, ...);
+int fmt_vprint(void (*put)(char c), const char *fmt, va_list ap);
+u32 fmt_divu10(u32 v, uint *r);
+
+#endif
+/* EOF */
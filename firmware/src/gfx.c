@@ -0,0 +1,311 @@
+/**
+ * @file  gfx.c
+ * @brief Graphics primitives, drawn into the display framebuffer
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "display.h"
+#include "gfx.h"
+#include "types.h"
+
+static u8   gfx_mask(int page, int y0, int y1);
+static inline u8 gfx_op(u8 old, u8 bits, u8 mask, uint mode);
+
+/**
+ * @brief Draw (set, clear or invert) one pixel
+ *
+ * @param x    Horizontal position of the pixel
+ * @param y    Vertical position of the pixel
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_pixel(int x, int y, uint mode)
+{
+	u8 *fb;
+	u8 v;
+
+	if ((x < 0) || (x >= DISP_WIDTH) || (y < 0) || (y >= DISP_HEIGHT))
+		return;
+
+	fb = disp_fb(y >> 3);
+	v  = gfx_op(fb[x], 0xFF, (1 << (y & 7)), mode);
+	if (v == fb[x])
+		return;
+	fb[x] = v;
+	disp_mark(y >> 3, x, x);
+}
+
+/**
+ * @brief Draw an horizontal line
+ *
+ * @param x0   Horizontal position of the first pixel
+ * @param x1   Horizontal position of the last pixel
+ * @param y    Vertical position of the line
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_hline(int x0, int x1, int y, uint mode)
+{
+	if (x1 < x0)
+		gfx_fill(x1, y, x0 - x1 + 1, 1, mode);
+	else
+		gfx_fill(x0, y, x1 - x0 + 1, 1, mode);
+}
+
+/**
+ * @brief Draw a vertical line
+ *
+ * @param x    Horizontal position of the line
+ * @param y0   Vertical position of the first pixel
+ * @param y1   Vertical position of the last pixel
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_vline(int x, int y0, int y1, uint mode)
+{
+	if (y1 < y0)
+		gfx_fill(x, y1, 1, y0 - y1 + 1, mode);
+	else
+		gfx_fill(x, y0, 1, y1 - y0 + 1, mode);
+}
+
+/**
+ * @brief Draw a line between two points (Bresenham algorithm)
+ *
+ * @param x0   Horizontal position of the first point
+ * @param y0   Vertical position of the first point
+ * @param x1   Horizontal position of the second point
+ * @param y1   Vertical position of the second point
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_line(int x0, int y0, int x1, int y1, uint mode)
+{
+	int dx, dy, sx, sy;
+	int err, e2;
+
+	// Horizontal and vertical lines are drawn by page
+	if (y0 == y1)
+	{
+		gfx_hline(x0, x1, y0, mode);
+		return;
+	}
+	if (x0 == x1)
+	{
+		gfx_vline(x0, y0, y1, mode);
+		return;
+	}
+
+	dx  = (x1 > x0) ? (x1 - x0) : (x0 - x1);
+	dy  = (y1 > y0) ? (y0 - y1) : (y1 - y0);
+	sx  = (x1 > x0) ? 1 : -1;
+	sy  = (y1 > y0) ? 1 : -1;
+	err = dx + dy;
+	while (1)
+	{
+		gfx_pixel(x0, y0, mode);
+		if ((x0 == x1) && (y0 == y1))
+			break;
+		e2 = (err << 1);
+		if (e2 >= dy)
+		{
+			err += dy;
+			x0  += sx;
+		}
+		if (e2 <= dx)
+		{
+			err += dx;
+			y0  += sy;
+		}
+	}
+}
+
+/**
+ * @brief Draw the outline of a rectangle
+ *
+ * @param x    Horizontal position of the top-left corner
+ * @param y    Vertical position of the top-left corner
+ * @param w    Width of the rectangle
+ * @param h    Height of the rectangle
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_rect(int x, int y, int w, int h, uint mode)
+{
+	if ((w <= 0) || (h <= 0))
+		return;
+
+	gfx_fill(x, y, w, 1, mode);
+	if (h == 1)
+		return;
+	gfx_fill(x, y + h - 1, w, 1, mode);
+	if (h == 2)
+		return;
+	// Vertical sides, without corners (already drawn)
+	gfx_fill(x,         y + 1, 1, h - 2, mode);
+	if (w > 1)
+		gfx_fill(x + w - 1, y + 1, 1, h - 2, mode);
+}
+
+/**
+ * @brief Fill (or invert) a rectangular area
+ *
+ * The area is processed page by page : for each page, one mask with all the
+ * rows of the area is applied to each column byte.
+ *
+ * @param x    Horizontal position of the top-left corner
+ * @param y    Vertical position of the top-left corner
+ * @param w    Width of the area
+ * @param h    Height of the area
+ * @param mode Drawing mode (GFX_CLR, GFX_SET or GFX_INV)
+ */
+void gfx_fill(int x, int y, int w, int h, uint mode)
+{
+	int xs, xe, x0, x1;
+	int p, c;
+	u8 *fb;
+	u8 mask, v;
+
+	// Clip area to the display
+	xs = (x < 0) ? 0 : x;
+	xe = ((x + w) > DISP_WIDTH) ? DISP_WIDTH : (x + w);
+	if ((xs >= xe) || (h <= 0))
+		return;
+
+	for (p = (y >> 3); p <= ((y + h - 1) >> 3); p++)
+	{
+		if ((p < 0) || (p >= DISP_PAGES))
+			continue;
+		mask = gfx_mask(p, y, y + h - 1);
+		fb = disp_fb(p);
+		x0 = DISP_WIDTH;
+		x1 = 0;
+		for (c = xs; c < xe; c++)
+		{
+			v = gfx_op(fb[c], 0xFF, mask, mode);
+			if (v == fb[c])
+				continue;
+			fb[c] = v;
+			if (c < x0)
+				x0 = c;
+			x1 = c;
+		}
+		if (x0 <= x1)
+			disp_mark(p, x0, x1);
+	}
+}
+
+/**
+ * @brief Draw a 1-bpp bitmap (icon) at any position
+ *
+ * The bitmap uses the same layout as the display : one byte per column with
+ * 8 rows per byte (LSB on top), and rows of bytes for each group of 8 lines.
+ * When the vertical position is not aligned on a page, each source byte is
+ * shifted and split over two pages of the display.
+ *
+ * @param x    Horizontal position of the top-left corner
+ * @param y    Vertical position of the top-left corner
+ * @param bmp  Pointer to the bitmap data ((h + 7) / 8 rows of w bytes)
+ * @param w    Width of the bitmap (in pixels)
+ * @param h    Height of the bitmap (in pixels)
+ * @param mode Drawing mode (GFX_CLR, GFX_SET, GFX_INV or GFX_COPY)
+ */
+RAMFUNC void gfx_blit(int x, int y, const u8 *bmp, int w, int h, uint mode)
+{
+	const u8 *lo, *hi;
+	int xs, xe, x0, x1;
+	int rows, sh, p, r, c;
+	u8 *fb;
+	u8 mask, v;
+
+	// Clip area to the display
+	xs = (x < 0) ? 0 : x;
+	xe = ((x + w) > DISP_WIDTH) ? DISP_WIDTH : (x + w);
+	if ((xs >= xe) || (h <= 0))
+		return;
+
+	rows = ((h + 7) >> 3);
+	sh   = (y & 7);
+	for (p = (y >> 3); p <= ((y + h - 1) >> 3); p++)
+	{
+		if ((p < 0) || (p >= DISP_PAGES))
+			continue;
+		// Source row shifted down into this page, and the one above it
+		r  = p - (y >> 3);
+		lo = (r < rows)        ? &bmp[(r    ) * w] : 0;
+		hi = ((r > 0) && (sh)) ? &bmp[(r - 1) * w] : 0;
+		mask = gfx_mask(p, y, y + h - 1);
+		fb = disp_fb(p);
+		x0 = DISP_WIDTH;
+		x1 = 0;
+		for (c = xs; c < xe; c++)
+		{
+			v = 0;
+			if (lo)
+				v  = (lo[c - x] << sh);
+			if (hi)
+				v |= (hi[c - x] >> (8 - sh));
+			v = gfx_op(fb[c], v, mask, mode);
+			if (v == fb[c])
+				continue;
+			fb[c] = v;
+			if (c < x0)
+				x0 = c;
+			x1 = c;
+		}
+		if (x0 <= x1)
+			disp_mark(p, x0, x1);
+	}
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                        Private gfx functions                         -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Compute the mask of the rows of an area into one page
+ *
+ * @param page Index of the page
+ * @param y0   Vertical position of the first row of the area
+ * @param y1   Vertical position of the last row of the area
+ * @return u8  Mask with one bit set for each row of the page into the area
+ */
+static u8 gfx_mask(int page, int y0, int y1)
+{
+	int top = (page << 3);
+	int lo, hi;
+
+	lo = (y0 > top)       ? (y0 - top) : 0;
+	hi = (y1 < (top + 7)) ? (y1 - top) : 7;
+	return( (0xFF << lo) & (0xFF >> (7 - hi)) );
+}
+
+/**
+ * @brief Apply a drawing operation on one column byte
+ *
+ * @param old  Current value of the column byte
+ * @param bits Pixels to draw
+ * @param mask Rows of the column that can be modified
+ * @param mode Drawing mode (GFX_CLR, GFX_SET, GFX_INV or GFX_COPY)
+ * @return u8  New value of the column byte
+ */
+static inline u8 gfx_op(u8 old, u8 bits, u8 mask, uint mode)
+{
+	bits &= mask;
+	switch (mode)
+	{
+		case GFX_CLR:
+			return(old & ~bits);
+		case GFX_SET:
+			return(old | bits);
+		case GFX_INV:
+			return(old ^ bits);
+		default:
+			return((old & ~mask) | bits);
+	}
+}
+/* EOF */
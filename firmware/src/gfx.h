@@ -0,0 +1,35 @@
+/**
+ * @file  gfx.h
+ * @brief Definitions and prototypes for graphics primitives
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef GFX_H
+#define GFX_H
+#include "hardware.h"
+#include "types.h"
+
+#define GFX_CLR  0 /* Clear pixels                          */
+#define GFX_SET  1 /* Set pixels                            */
+#define GFX_INV  2 /* Invert pixels                         */
+#define GFX_COPY 3 /* Copy bitmap (set and clear pixels)    */
+
+void gfx_pixel(int x, int y, uint mode);
+void gfx_hline(int x0, int x1, int y, uint mode);
+void gfx_vline(int x, int y0, int y1, uint mode);
+void gfx_line (int x0, int y0, int x1, int y1, uint mode);
+void gfx_rect (int x, int y, int w, int h, uint mode);
+void gfx_fill (int x, int y, int w, int h, uint mode);
+RAMFUNC void gfx_blit (int x, int y, const u8 *bmp, int w, int h, uint mode);
+
+#endif
+/* EOF */
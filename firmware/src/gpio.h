@@ -0,0 +1,161 @@
+/**
+ * @file  gpio.h
+ * @brief Fast access to IOs using the single-cycle IOBUS port
+ *
+ * All functions use a bitmask of pins, built with the GPIO() macro. This
+ * macro checks at compile time that the pin exists on the package (SAMC21E /
+ * SAMD21E, port A only) : GPIO(PIN_xxx) | GPIO(PIN_yyy) can be used to
+ * update several pins with one single access.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef GPIO_H
+#define GPIO_H
+#include "hardware.h"
+#include "types.h"
+
+#define GPIO_ADDR ((u32)0x60000000)
+
+/* Pins available on the 32 pins package */
+#define GPIO_VALID 0xDBCFCFFFUL
+
+/* Pins of the board */
+#define PIN_DISP_ERD  0
+#define PIN_DISP_RW   1
+#define PIN_DISP_DC   2
+#define PIN_DISP_RST  3
+#define PIN_DISP_MOSI 4
+#define PIN_DISP_SCK  5
+#define PIN_DISP_NSS  6
+#define PIN_DISP_MISO 7
+#define PIN_SW1      27
+#define PIN_SW2      11
+#define PIN_SW3      14
+#define PIN_SW4      10
+#define PIN_SW5      15
+#define PIN_LED      28
+
+/* Values for gpio_cfg() (PINCFG register) */
+#define GPIO_CFG_PMUX  0x01
+#define GPIO_CFG_INEN  0x02
+#define GPIO_CFG_PULL  0x04
+#define GPIO_CFG_DRV   0x40
+
+/* Bitmask of one pin, with compile-time check of the pin number */
+#define GPIO(pin) (GPIO_CHECK(pin) << (pin))
+#define GPIO_CHECK(pin) ((u32)sizeof(struct { \
+	_Static_assert(((pin) >= 0) && ((pin) < 32) && \
+	               ((GPIO_VALID >> (pin)) & 1), "invalid pin " #pin); \
+	u8 one; }))
+
+/**
+ * @brief Set pins to high level
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_set(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x18, mask); /* OUTSET */
+}
+
+/**
+ * @brief Set pins to low level
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_clr(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x14, mask); /* OUTCLR */
+}
+
+/**
+ * @brief Invert the level of pins
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_toggle(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x1C, mask); /* OUTTGL */
+}
+
+/**
+ * @brief Read the input level of pins
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ * @return u32 Bitmask of pins at high level (only bits of mask)
+ */
+static inline u32 gpio_read(u32 mask)
+{
+	return(reg_rd(GPIO_ADDR + 0x20) & mask); /* IN */
+}
+
+/**
+ * @brief Configure pins as output
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_output(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x08, mask); /* DIRSET */
+}
+
+/**
+ * @brief Configure pins as input
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_input(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x04, mask); /* DIRCLR */
+}
+
+/**
+ * @brief Configure one pin (PINCFG)
+ *
+ * @param pin Pin number
+ * @param cfg Configuration, see GPIO_CFG_xxx
+ */
+static inline void gpio_cfg(uint pin, u8 cfg)
+{
+	reg8_wr(GPIO_ADDR + 0x40 + pin, cfg);
+}
+
+/**
+ * @brief Select the peripheral function of one pin (PMUX)
+ *
+ * The pin must also be configured with GPIO_CFG_PMUX to use the function.
+ *
+ * @param pin Pin number
+ * @param fn  Peripheral function (0 for A, 1 for B, ...)
+ */
+static inline void gpio_pmux(uint pin, uint fn)
+{
+	u32 reg = GPIO_ADDR + 0x30 + (pin >> 1);
+
+	if (pin & 1)
+		reg8_wr(reg, (reg8_rd(reg) & 0x0F) | (fn << 4));
+	else
+		reg8_wr(reg, (reg8_rd(reg) & 0xF0) | fn);
+}
+
+/**
+ * @brief Enable continuous sampling of inputs (faster read)
+ *
+ * @param mask Bitmask of pins (see GPIO macro)
+ */
+static inline void gpio_sampling(u32 mask)
+{
+	reg_wr(GPIO_ADDR + 0x24, reg_rd(GPIO_ADDR + 0x24) | mask); /* CTRL */
+}
+
+#endif
+/* EOF */
@@ -13,6 +13,7 @@
  * with this program, see LICENSE.md file for more details.
  * This program is distributed WITHOUT ANY WARRANTY.
  */
+#include "gpio.h"
 #include "hardware.h"
 
 static inline void hw_init_button(void);
@@ -47,35 +48,26 @@ void hw_init(void)
  */
 static inline void hw_init_button(void)
 {
-	/* Configure SW1 (PA27) */
-	reg_wr (0x60000000 + 0x04, (1 << 27)); // DIR
-	reg_wr (0x60000000 + 0x18, (1 << 27)); // Set out=1 for pull-up
-	reg8_wr(0x60000000 + 0x5B,  0x06);     // PINCFG: Input with pull-up
-	reg_set(0x60000000 + 0x24, (1 << 27)); // Continuous sampling
-
-	/* Configure SW2 (PA11) */
-	reg_wr (0x60000000 + 0x04, (1 << 11)); // DIR
-	reg_wr (0x60000000 + 0x18, (1 << 11)); // Set out=1 for pull-up
-	reg8_wr(0x60000000 + 0x4B,  0x06);     // PINCFG: Input with pull-up
-	reg_set(0x60000000 + 0x24, (1 << 11)); // Continuous sampling
-
-	/* Configure SW3 (PA14) */
-	reg_wr (0x60000000 + 0x04, (1 << 14)); // DIR
-	reg_wr (0x60000000 + 0x18, (1 << 14)); // Set out=1 for pull-up
-	reg8_wr(0x60000000 + 0x4E,  0x06);     // PINCFG: Input with pull-up
-	reg_set(0x60000000 + 0x24, (1 << 14)); // Continuous sampling
-
-	/* Configure SW4 (PA10) */
-	reg_wr (0x60000000 + 0x04, (1 << 10)); // DIR
-	reg_wr (0x60000000 + 0x18, (1 << 10)); // Set out=1 for pull-up
-	reg8_wr(0x60000000 + 0x4A,  0x06);     // PINCFG: Input with pull-up
-	reg_set(0x60000000 + 0x24, (1 << 10)); // Continuous sampling
-
-	/* Configure SW5 (PA15) */
-	reg_wr (0x60000000 + 0x04, (1 << 15)); // DIR
-	reg_wr (0x60000000 + 0x18, (1 << 15)); // Set out=1 for pull-up
-	reg8_wr(0x60000000 + 0x4F,  0x06);     // PINCFG: Input with pull-up
-	reg_set(0x60000000 + 0x24, (1 << 15)); // Continuous sampling
+	u32 sw = GPIO(PIN_SW1) | GPIO(PIN_SW2) | GPIO(PIN_SW3) |
+	         GPIO(PIN_SW4) | GPIO(PIN_SW5);
+
+	/* All buttons : input, out=1 for pull-up, continuous sampling */
+	gpio_input(sw);
+	gpio_set(sw);
+	gpio_sampling(sw);
+
+	/* Configure SW1 (PA27) : input with pull-up */
+	gpio_cfg(PIN_SW1, GPIO_CFG_INEN | GPIO_CFG_PULL);
+
+	/* SW2 to SW5 are connected to EIC (see button.c), SW1 is polled */
+	gpio_cfg(PIN_SW2, GPIO_CFG_INEN | GPIO_CFG_PULL | GPIO_CFG_PMUX);
+	gpio_cfg(PIN_SW3, GPIO_CFG_INEN | GPIO_CFG_PULL | GPIO_CFG_PMUX);
+	gpio_cfg(PIN_SW4, GPIO_CFG_INEN | GPIO_CFG_PULL | GPIO_CFG_PMUX);
+	gpio_cfg(PIN_SW5, GPIO_CFG_INEN | GPIO_CFG_PULL | GPIO_CFG_PMUX);
+	gpio_pmux(PIN_SW2, 0); /* A : EIC */
+	gpio_pmux(PIN_SW3, 0);
+	gpio_pmux(PIN_SW4, 0);
+	gpio_pmux(PIN_SW5, 0);
 }
 
 /**
@@ -180,38 +172,29 @@ static inline void hw_init_clock(void)
  */
 static inline void hw_init_display(void)
 {
-	/* Configure DISP_RST (PA03) */
-	reg_wr(0x60000000 + 0x14, (1 << 03)); // OUT=0 (active reset !)
-	reg_wr(0x60000000 + 0x08, (1 << 03)); // DIR: output
-	reg8_wr(0x60000000 + 0x43, 0x00); // PINCFG: normal, no-pull, no pmux
-
-	/* Configure DISP_DC (PA02) */
-	reg_wr(0x60000000 + 0x14, (1 << 02)); // OUT=0
-	reg_wr(0x60000000 + 0x08, (1 << 02)); // DIR: output
-	reg8_wr(0x60000000 + 0x42, 0x00); // PINCFG: normal, no-pull, no pmux
-
-	/* Configure DISP_RW (PA01) */
-	reg_wr(0x60000000 + 0x14, (1 << 01)); // OUT=0
-	reg_wr(0x60000000 + 0x08, (1 << 01)); // DIR: output
-	reg8_wr(0x60000000 + 0x41, 0x00); // PINCFG: normal, no-pull, no pmux
-
-	/* Configure DISP_ERD (PA00) */
-	reg_wr(0x60000000 + 0x14, (1 << 00)); // OUT=0
-	reg_wr(0x60000000 + 0x08, (1 << 00)); // DIR: output
-	reg8_wr(0x60000000 + 0x40, 0x00); // PINCFG: normal, no-pull, no pmux
+	u32 ctrl = GPIO(PIN_DISP_RST) | GPIO(PIN_DISP_DC) |
+	           GPIO(PIN_DISP_RW)  | GPIO(PIN_DISP_ERD);
+
+	/* DISP_RST (PA03), DISP_DC (PA02), DISP_RW (PA01), DISP_ERD (PA00) */
+	gpio_clr(ctrl);    // OUT=0 (active reset !)
+	gpio_output(ctrl); // DIR: output
+	gpio_cfg(PIN_DISP_RST, 0); // PINCFG: normal, no-pull, no pmux
+	gpio_cfg(PIN_DISP_DC,  0);
+	gpio_cfg(PIN_DISP_RW,  0);
+	gpio_cfg(PIN_DISP_ERD, 0);
 
 	/* Configure DISP_NSS (PA06) */
-	reg_wr(0x60000000 + 0x18, (1 << 06)); // OUT=1
-	reg_wr(0x60000000 + 0x08, (1 << 06)); // DIR: output
-	reg8_wr(0x60000000 + 0x46, 0x00); // PINCFG: normal, no-pull, no pmux
-
-	/* Configure SPI lines (PA04, PA05, PA06, PA07) */
-	reg8_wr(0x60000000 + 0x44, 0x01); // PINCFG: Set PMUX for PA04 (MOSI)
-	reg8_wr(0x60000000 + 0x45, 0x01); // PINCFG: Set PMUX for PA05 (SCK)
-	reg8_wr(0x60000000 + 0x46, 0x00); // PINCFG: No-PMUX  for PA06 (NSS)
-	reg8_wr(0x60000000 + 0x47, 0x01); // PINCFG: Set PMUX for PA07 (MISO)
-	reg8_wr(0x60000000 + 0x32, (0x03 << 4) | (0x03 << 0)); // PMUX: D
-	reg8_wr(0x60000000 + 0x33, (0x03 << 4) | (0x03 << 0)); // PMUX: D
+	gpio_set(GPIO(PIN_DISP_NSS));    // OUT=1
+	gpio_output(GPIO(PIN_DISP_NSS)); // DIR: output
+	gpio_cfg(PIN_DISP_NSS, 0);       // PINCFG: normal, no-pull, no pmux
+
+	/* Configure SPI lines (PA04, PA05, PA07), function D */
+	gpio_cfg(PIN_DISP_MOSI, GPIO_CFG_PMUX);
+	gpio_cfg(PIN_DISP_SCK,  GPIO_CFG_PMUX);
+	gpio_cfg(PIN_DISP_MISO, GPIO_CFG_PMUX);
+	gpio_pmux(PIN_DISP_MOSI, 3);
+	gpio_pmux(PIN_DISP_SCK,  3);
+	gpio_pmux(PIN_DISP_MISO, 3);
 }
 
 /**
@@ -221,11 +204,11 @@ static inline void hw_init_display(void)
 static inline void hw_init_leds(void)
 {
 	/* Set LED "OFF" (pin output=1) */
-	reg_wr(0x60000000 + 0x18, (1 << 28));
+	gpio_set(GPIO(PIN_LED));
 	/* DIR: Set PA28 as output */
-	reg_wr(0x60000000 + 0x08, (1 << 28));
+	gpio_output(GPIO(PIN_LED));
 	/* PINCFG: Configure PA28 (strong strength, no pull, no pmux) */
-	reg8_wr(0x60000000 + 0x5C, 0x40);
+	gpio_cfg(PIN_LED, GPIO_CFG_DRV);
 }
 
 /**
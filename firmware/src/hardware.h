@@ -57,6 +57,20 @@
 #define I2S_ADDR     ((u32)0x42005000)
 #define AC1_ADDR     ((u32)0x42005400)
 #define TCC3_ADDR    ((u32)0x42006000)
+/* Cortex-M0+ System Control Space */
+#define NVIC_ADDR    ((u32)0xE000E100)
+
+/*
+ * Functions tagged with RAMFUNC are copied to SRAM with .data at reset and
+ * run without flash wait states. Flash and SRAM are too far for a BL, so
+ * calls to these functions use long_call (the tag must be on prototype
+ * too). Build with "make RAMFUNC=0" to keep them into flash.
+ */
+#ifdef RAMFUNC_DISABLE
+#define RAMFUNC
+#else
+#define RAMFUNC __attribute__((section(".ramfunc"), long_call, noinline))
+#endif
 
 void hw_init(void);
 
@@ -137,4 +151,44 @@ static inline void reg_set(u32 reg, u32 value)
   *(volatile u32 *)reg = (*(volatile u32 *)reg | value);
 }
 
+/**
+ * @brief Connect a generic clock to another generator
+ *
+ * The generator of a running generic clock can not be modified : the clock
+ * is disabled first, and selected again once CLKEN reads zero.
+ *
+ * @param id  Index of the generic clock (CLKCTRL.ID)
+ * @param gen Index of the new clock generator
+ */
+static inline void gclk_select(u8 id, u8 gen)
+{
+	reg16_wr(GCLK_ADDR + 0x02, id);
+	while (reg16_rd(GCLK_ADDR + 0x02) & (1 << 14))
+		;
+	reg16_wr(GCLK_ADDR + 0x02, (1 << 14) | (gen << 8) | id);
+}
+
+/**
+ * @brief Disable interrupts and return the previous state
+ *
+ * @return u32 Previous value of PRIMASK, to be used with irq_restore()
+ */
+static inline u32 irq_save(void)
+{
+	u32 primask;
+	asm volatile("mrs %0, primask\n"
+	             "cpsid i" : "=r" (primask) : : "memory");
+	return(primask);
+}
+
+/**
+ * @brief Restore interrupts state saved by irq_save()
+ *
+ * @param primask Value returned by the matching irq_save()
+ */
+static inline void irq_restore(u32 primask)
+{
+	asm volatile("msr primask, %0" : : "r" (primask) : "memory");
+}
+
 #endif
@@ -0,0 +1,370 @@
+/**
+ * @file  link.c
+ * @brief Framed binary protocol over the system UART (link with ESP32)
+ *
+ * Messages are sent into frames protected by a CRC16 and encoded with COBS
+ * (Consistent Overhead Byte Stuffing). After encoding, a frame contains no
+ * 0x00 byte, so 0x00 is used as frame delimiter : after line noise or a lost
+ * byte, the receiver is synchronized again at the next delimiter.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "console.h"
+#include "display.h"
+#include "link.h"
+#include "uart.h"
+
+/* Size of a decoded frame : type, seq, payload and CRC */
+#define LINK_FRAME (LINK_MTU + 4)
+/* Size of an encoded frame : one COBS overhead byte every 254 bytes */
+#define LINK_FRAME_ENC (LINK_FRAME + (LINK_FRAME / 254) + 3)
+
+static u16  link_crc(u16 crc, u8 v);
+static void link_dispatch(u8 *msg, uint len);
+static inline void link_store(u8 v);
+
+/* CRC16-CCITT for one nibble (polynomial 0x1021) */
+static const u16 crc_nibble[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/* Receive state */
+static u8   rx_frame[LINK_FRAME];
+static uint rx_len;
+static u16  rx_crc;
+static u8   rx_code;  /* Number of bytes until next COBS code byte        */
+static u8   rx_zero;  /* Set when a zero must be added before next block  */
+static u8   rx_drop;  /* Set to ignore bytes until next delimiter         */
+static u8   rx_seq;   /* Sequence number expected for next frame          */
+static u8   rx_sync;  /* Set when a first frame has been received         */
+/* Transmit state */
+static u8   tx_frame[LINK_FRAME_ENC];
+static u8   tx_seq;
+static u8   tx_flush; /* Set when a display flush is pending */
+static u8   con_on;   /* Set when the console uses the display */
+static void (*link_wake)(void);
+
+static struct link_stats stats;
+
+/**
+ * @brief Initialize the link
+ *
+ * A delimiter is sent, so the first frame sent by the ESP32 before the UI
+ * was ready is discarded, as any incomplete frame.
+ *
+ * @param wake Function called (from interrupt) when link_poll() has work :
+ *             bytes received, or end of a display flush
+ */
+void link_init(void (*wake)(void))
+{
+	u8 delim = 0x00;
+
+	link_wake = wake;
+	uart_rx_hook(LINK_PORT, wake);
+
+	rx_len  = 0;
+	rx_crc  = 0xFFFF;
+	rx_code = 0;
+	rx_zero = 0;
+	rx_drop = 0;
+	tx_seq  = 0;
+	uart_write(LINK_PORT, &delim, 1);
+}
+
+/**
+ * @brief Process received bytes
+ *
+ * This function must be called periodically (from main loop). All bytes
+ * waiting into the UART receive buffer are decoded (directly from it, no
+ * intermediate copy) and complete messages are processed.
+ */
+void link_poll(void)
+{
+	const u8 *data;
+	int len;
+
+	/* Decode bytes in place, and release them by small chunks so the
+	 * ISR can keep receiving while long frames are processed */
+	while ((len = uart_rx_span(LINK_PORT, &data, 32)) > 0)
+	{
+		link_feed(data, len);
+		uart_rx_release(LINK_PORT, len);
+	}
+
+	if (tx_flush && (disp_flush_async(link_wake) == 0))
+		tx_flush = 0;
+}
+
+/**
+ * @brief Decode received bytes
+ *
+ * COBS is decoded on the fly : each byte is written only once, at its final
+ * place into the frame buffer, and the CRC is updated at the same time. When
+ * a delimiter is found, the message is processed from the frame buffer
+ * itself (no copy).
+ *
+ * @param data Pointer to the received (encoded) bytes
+ * @param len  Number of bytes
+ */
+void link_feed(const u8 *data, int len)
+{
+	u8 v;
+
+	for ( ; len > 0; len--)
+	{
+		v = *data++;
+
+		/* End of frame */
+		if (v == 0x00)
+		{
+			if (rx_drop || (rx_code != 0))
+				stats.rx_error++;
+			else if (rx_len == 0)
+				; /* Empty frame (consecutive delimiters) */
+			else if (rx_len < 4)
+				stats.rx_error++;
+			else if (rx_crc != 0)
+				stats.rx_crc++;
+			else
+			{
+				stats.rx_frames++;
+				if (rx_sync)
+					stats.rx_lost += (u8)(rx_frame[1] - rx_seq);
+				rx_sync = 1;
+				rx_seq  = rx_frame[1] + 1;
+				link_dispatch(rx_frame, rx_len - 2);
+			}
+			rx_len  = 0;
+			rx_crc  = 0xFFFF;
+			rx_code = 0;
+			rx_zero = 0;
+			rx_drop = 0;
+			continue;
+		}
+		if (rx_drop)
+			continue;
+
+		if (rx_code)
+		{
+			rx_code--;
+			link_store(v);
+			continue;
+		}
+		/* Code byte : the previous block ended with a zero (if not full) */
+		if (rx_zero)
+			link_store(0x00);
+		rx_code = v - 1;
+		rx_zero = (v != 0xFF);
+	}
+}
+
+/**
+ * @brief Send a message to the ESP32
+ *
+ * @param type Type of the message (see LINK_xxx into link.h)
+ * @param data Pointer to the payload (can be NULL if len is zero)
+ * @param len  Length of the payload (in bytes)
+ * @return integer Zero on success, -1 if payload is too long
+ */
+int link_send(u8 type, const u8 *data, uint len)
+{
+	u8   hdr[2];
+	u8   v;
+	u16  crc;
+	uint code; /* Index of the current code byte */
+	uint pos;
+	uint i;
+
+	if (len > LINK_MTU)
+		return(-1);
+
+	hdr[0] = type;
+	hdr[1] = tx_seq++;
+	crc  = 0xFFFF;
+	code = 0;
+	pos  = 1;
+	for (i = 0; i < (len + 4); i++)
+	{
+		if (i < 2)
+			v = hdr[i];
+		else if (i < (len + 2))
+			v = data[i - 2];
+		else if (i == (len + 2))
+			v = (crc >> 8);
+		else
+			v = (crc & 0xFF);
+		if (i < (len + 2))
+			crc = link_crc(crc, v);
+
+		if (v != 0x00)
+			tx_frame[pos++] = v;
+		/* End of COBS block : on a zero, or after 254 data bytes */
+		if ((v == 0x00) || ((pos - code) == 0xFF))
+		{
+			tx_frame[code] = (pos - code);
+			code = pos++;
+		}
+	}
+	tx_frame[code] = (pos - code);
+	tx_frame[pos++] = 0x00;
+
+	uart_write(LINK_PORT, tx_frame, pos);
+	stats.tx_frames++;
+	return(0);
+}
+
+/**
+ * @brief Get statistics of the link (errors, number of frames)
+ *
+ * @return struct* Pointer to the statistics structure
+ */
+const struct link_stats *link_stats(void)
+{
+	return(&stats);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Update a CRC16-CCITT with one byte
+ *
+ * @param crc Current value of the CRC
+ * @param v   Byte to add
+ * @return u16 New value of the CRC
+ */
+static u16 link_crc(u16 crc, u8 v)
+{
+	crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (v >> 4)];
+	crc = (crc << 4) ^ crc_nibble[(crc >> 12) ^ (v & 0x0F)];
+	return(crc);
+}
+
+/**
+ * @brief Process a received message
+ *
+ * @param msg Pointer to the message (type, seq, payload)
+ * @param len Length of the message, without CRC
+ */
+static void link_dispatch(u8 *msg, uint len)
+{
+	u8  *payload = msg + 2;
+	u8  *fb;
+	u8   ack[2];
+	u32  rate;
+	uint i;
+
+	len -= 2;
+	ack[0] = msg[1];
+	ack[1] = 0;
+
+	switch(msg[0])
+	{
+		case LINK_PING:
+			link_send(LINK_PONG, payload, len);
+			break;
+
+		case LINK_BAUD:
+			if (len != 4)
+			{
+				stats.rx_error++;
+				break;
+			}
+			rate = (u32)payload[0]         | ((u32)payload[1] << 8) |
+			       ((u32)payload[2] << 16) | ((u32)payload[3] << 24);
+			/* Rate refused, the ESP32 stays at the current one */
+			if (uart_baud_check(rate, 0) == 0)
+				ack[1] = 1;
+			/* Acknowledge at old rate, then switch (the ACK is flushed) */
+			link_send(LINK_ACK, ack, 2);
+			if (ack[1] == 0)
+				uart_set_baud(LINK_PORT, rate, 0);
+			break;
+
+		case LINK_CLEAR:
+			/* End of console, pages are shown at their own place again */
+			if (con_on)
+			{
+				disp_scroll(0);
+				con_on = 0;
+			}
+			disp_clear(len ? payload[0] : 0xFF);
+			break;
+
+		case LINK_TEXT:
+			if (len < 2)
+				break;
+			disp_pos(payload[0], payload[1]);
+			for (i = 2; i < len; i++)
+				disp_putc(payload[i]);
+			break;
+
+		case LINK_PAGE:
+			if ((len < 3) || (payload[0] >= DISP_PAGES) ||
+			    (payload[1] >= DISP_WIDTH))
+				break;
+			if ((payload[1] + len - 2) > DISP_WIDTH)
+				len = DISP_WIDTH - payload[1] + 2;
+			fb = disp_fb(payload[0]) + payload[1];
+			for (i = 2; i < len; i++)
+				fb[i - 2] = payload[i];
+			disp_mark(payload[0], payload[1], payload[1] + len - 3);
+			break;
+
+		case LINK_FLUSH:
+			/* If a flush is in progress, retry from link_poll() */
+			if (disp_flush_async(link_wake) < 0)
+				tx_flush = 1;
+			break;
+
+		case LINK_DELTA:
+			if (disp_delta(payload, len) < 0)
+				stats.rx_error++;
+			break;
+
+		case LINK_LINE:
+			/* First console text, start with a blank screen */
+			if (con_on == 0)
+			{
+				con_init();
+				con_on = 1;
+			}
+			for (i = 0; i < len; i++)
+				con_putc(payload[i]);
+			break;
+
+		default:
+			stats.rx_unknown++;
+			break;
+	}
+}
+
+/**
+ * @brief Add one decoded byte to the received frame
+ *
+ * @param v Value of the byte
+ */
+static inline void link_store(u8 v)
+{
+	if (rx_len == LINK_FRAME)
+	{
+		rx_drop = 1;
+		return;
+	}
+	rx_frame[rx_len++] = v;
+	rx_crc = link_crc(rx_crc, v);
+}
+/* EOF */
@@ -0,0 +1,62 @@
+/**
+ * @file  link.h
+ * @brief Definitions and prototypes for the framed link with the ESP32
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef LINK_H
+#define LINK_H
+#include "types.h"
+#include "uart.h"
+
+#define LINK_PORT UART_SYS
+/* Max size of a message payload */
+#define LINK_MTU  192
+
+/*
+ * Frame format (before COBS encoding, then terminated by 0x00) :
+ *   type (1) | seq (1) | payload (0 to LINK_MTU) | crc16 (2, MSB first)
+ * CRC is CRC16-CCITT (poly 0x1021, init 0xFFFF) of type, seq and payload.
+ */
+
+/* Messages from ESP32 to UI */
+#define LINK_PING   0x01 /* Answered by PONG with the same payload          */
+#define LINK_BAUD   0x02 /* u32 rate (LSB first), one ACK at the old rate   */
+#define LINK_CLEAR  0x10 /* u8 bitmask of pages to clear                    */
+#define LINK_TEXT   0x11 /* u8 x (multiple of 8 pixels), u8 page, chars     */
+#define LINK_PAGE   0x12 /* u8 page, u8 x, raw columns of the page          */
+#define LINK_FLUSH  0x13 /* Send modified parts of framebuffer to display   */
+#define LINK_DELTA  0x14 /* Spans of columns to update (see disp_delta)     */
+#define LINK_LINE   0x15 /* Console text, '\n' starts a new line            */
+/* Messages from UI to ESP32 */
+#define LINK_PONG   0x81 /* Copy of the PING payload                        */
+#define LINK_ACK    0x82 /* u8 seq of the request, u8 status (0 = success)  */
+#define LINK_BUTTON 0x83 /* u8 button (mask for chords), u8 BTN_EV_xxx     */
+
+struct link_stats
+{
+	u32 rx_frames;  /* Number of valid received frames                */
+	u32 rx_crc;     /* Frames dropped because of bad CRC              */
+	u32 rx_error;   /* Frames dropped (too long, too short, bad COBS) */
+	u32 rx_lost;    /* Frames missing according to sequence numbers   */
+	u32 rx_unknown; /* Valid frames with an unknown type              */
+	u32 tx_frames;  /* Number of sent frames                          */
+};
+
+void link_feed(const u8 *data, int len);
+void link_init(void (*wake)(void));
+void link_poll(void);
+int  link_send(u8 type, const u8 *data, uint len);
+const struct link_stats *link_stats(void);
+
+#endif
+/* EOF */
@@ -0,0 +1,154 @@
+/**
+ * @file  log.c
+ * @brief Tokenized logging into a RAM buffer, drained to the debug UART
+ *
+ * Each record uses (2 + N) words into the buffer : a header (format string
+ * address in bits 31:8, level in bits 7:4 and number of arguments in bits
+ * 3:0), a timestamp and N arguments. When drained, a record is sent as :
+ *   0xFE | number of words (1 byte) | words (LSB first)
+ * Text sent with uart_puts() never contains 0xFE, so the host decoder can
+ * extract records from the normal console output.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <stdarg.h>
+#include "hardware.h"
+#include "log.h"
+#include "timer.h"
+#include "uart.h"
+
+/* Size of the record buffer, in words (must be a power of 2) */
+#define LOG_SIZE 128
+/* Start of frame sent on UART */
+#define LOG_SOF  0xFE
+/* Timestamp of records */
+#ifndef LOG_TIME
+#define LOG_TIME() timer_us()
+#endif
+
+static void log_send(const u32 *rec, uint n);
+
+static u32  log_buf[LOG_SIZE];
+static volatile uint log_head; /* Next free word (updated by log_write)  */
+static volatile uint log_tail; /* First used word (updated by log_drain) */
+static volatile u32  log_lost; /* Records discarded because buffer full */
+
+/**
+ * @brief Send pending log records to the debug UART
+ *
+ * This function should be called when the firmware is idle. Records are
+ * sent only if they fit into the UART transmit buffer, so this function
+ * never waits.
+ */
+void log_drain(void)
+{
+	u32  rec[2 + LOG_ARGS_MAX];
+	u32  primask;
+	uint tail, n, i;
+
+	/* Report discarded records first (level 0 record, one argument) */
+	if (log_lost && (uart_space(UART_DBG) >= (2 + 3 * 4)))
+	{
+		primask = irq_save();
+		rec[2] = log_lost;
+		log_lost = 0;
+		irq_restore(primask);
+		rec[0] = 1;
+		rec[1] = LOG_TIME();
+		log_send(rec, 3);
+	}
+
+	tail = log_tail;
+	while (tail != log_head)
+	{
+		n = 2 + (log_buf[tail] & 0x0F);
+		if (uart_space(UART_DBG) < (int)(2 + n * 4))
+			break;
+		for (i = 0; i < n; i++)
+		{
+			rec[i] = log_buf[tail];
+			tail = (tail + 1) & (LOG_SIZE - 1);
+		}
+		log_tail = tail;
+		log_send(rec, n);
+	}
+}
+
+/**
+ * @brief Store a log record
+ *
+ * This function is called by LOG_xxx macros, it can be used from interrupt
+ * handlers. If the buffer is full, the record is discarded (and counted).
+ *
+ * @param hdr Header of the record (format address, level, number of args)
+ */
+void log_write(u32 hdr, ...)
+{
+	va_list ap;
+	u32  primask;
+	uint n, head;
+
+	n = (hdr & 0x0F);
+
+	primask = irq_save();
+	head = log_head;
+	if (((log_tail - head - 1) & (LOG_SIZE - 1)) < (n + 2))
+	{
+		log_lost++;
+		irq_restore(primask);
+		return;
+	}
+	log_buf[head] = hdr;
+	head = (head + 1) & (LOG_SIZE - 1);
+	log_buf[head] = LOG_TIME();
+	head = (head + 1) & (LOG_SIZE - 1);
+	va_start(ap, hdr);
+	for ( ; n; n--)
+	{
+		log_buf[head] = va_arg(ap, u32);
+		head = (head + 1) & (LOG_SIZE - 1);
+	}
+	va_end(ap);
+	log_head = head;
+	irq_restore(primask);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Send one record to the debug UART
+ *
+ * @param rec Pointer to the words of the record
+ * @param n   Number of words
+ */
+static void log_send(const u32 *rec, uint n)
+{
+	u8   frame[2 + (2 + LOG_ARGS_MAX) * 4];
+	u8  *p = frame;
+	uint i;
+
+	*p++ = LOG_SOF;
+	*p++ = n;
+	for (i = 0; i < n; i++)
+	{
+		*p++ = (rec[i] >>  0);
+		*p++ = (rec[i] >>  8);
+		*p++ = (rec[i] >> 16);
+		*p++ = (rec[i] >> 24);
+	}
+	uart_write(UART_DBG, frame, p - frame);
+}
+/* EOF */
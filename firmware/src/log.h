@@ -0,0 +1,87 @@
+/**
+ * @file  log.h
+ * @brief Definitions and macros for tokenized logging
+ *
+ * Log macros only store a small binary record into a RAM buffer : the
+ * address of the format string (used as identifier), a timestamp and the
+ * arguments. Format strings are placed into the ".logstr" section, which is
+ * kept into the ELF file but not loaded into flash. The records are sent
+ * later to the debug UART by log_drain() and decoded by scripts/logdec.py.
+ *
+ * Levels are selected at compile time, with LOG_LEVEL (for the whole
+ * firmware) or LOG_MODULE_LEVEL (defined by a module before including this
+ * file). Disabled logs are removed by the preprocessor.
+ *
+ * Arguments are 32 bits integers (up to LOG_ARGS_MAX, checked at compile
+ * time), format strings can use the conversions of fmt_vprint except %s.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef LOG_H
+#define LOG_H
+#include "types.h"
+
+#define LOG_LVL_NONE 0
+#define LOG_LVL_ERR  1
+#define LOG_LVL_WARN 2
+#define LOG_LVL_INFO 3
+#define LOG_LVL_DBG  4
+
+/* Default level for the whole firmware */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LVL_INFO
+#endif
+/* Level of the current module (can be defined before including log.h) */
+#ifndef LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL LOG_LEVEL
+#endif
+
+#define LOG_ARGS_MAX 4
+
+/* Count the arguments (up to 8, to detect more than LOG_ARGS_MAX) */
+#define LOG_NARGS(...) LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(z, a, b, c, d, e, f, g, h, n, ...) n
+
+#define LOG_RECORD(lvl, fmt, ...) do { \
+	_Static_assert(LOG_NARGS(__VA_ARGS__) <= LOG_ARGS_MAX, \
+	               "too many arguments for a log record"); \
+	static const char log_fmt[] __attribute__((section(".logstr"))) = fmt; \
+	log_write(((u32)log_fmt << 8) | ((lvl) << 4) | LOG_NARGS(__VA_ARGS__), \
+	          ##__VA_ARGS__); \
+} while(0)
+
+#if LOG_MODULE_LEVEL >= LOG_LVL_ERR
+#define LOG_ERR(...)  LOG_RECORD(LOG_LVL_ERR,  __VA_ARGS__)
+#else
+#define LOG_ERR(...)  do { } while(0)
+#endif
+#if LOG_MODULE_LEVEL >= LOG_LVL_WARN
+#define LOG_WARN(...) LOG_RECORD(LOG_LVL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do { } while(0)
+#endif
+#if LOG_MODULE_LEVEL >= LOG_LVL_INFO
+#define LOG_INFO(...) LOG_RECORD(LOG_LVL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do { } while(0)
+#endif
+#if LOG_MODULE_LEVEL >= LOG_LVL_DBG
+#define LOG_DBG(...)  LOG_RECORD(LOG_LVL_DBG,  __VA_ARGS__)
+#else
+#define LOG_DBG(...)  do { } while(0)
+#endif
+
+void log_drain(void);
+void log_write(u32 hdr, ...);
+
+#endif
+/* EOF */
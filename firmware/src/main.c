@@ -13,10 +13,35 @@
  * with this program, see LICENSE.md file for more details.
  * This program is distributed WITHOUT ANY WARRANTY.
  */
+#include "button.h"
 #include "display.h"
+#include "gpio.h"
 #include "hardware.h"
+#include "link.h"
+#include "log.h"
+#include "mtb.h"
+#include "prof.h"
+#include "sched.h"
+#include "timer.h"
 #include "uart.h"
 
+/* Tasks, by priority */
+#define TASK_INPUT 0
+#define TASK_LINK  1
+#define TASK_TIMER 2
+#define TASK_PROF  3
+
+static void led_blink(void *arg);
+static void task_input(void);
+static void wake_input(void);
+static void wake_link(void);
+#ifdef PROF_ENABLE
+static void wake_prof(void);
+#endif
+static void wake_timer(void);
+
+static struct timer led_timer;
+
 /**
  * @brief Entry point of the C code
  *
@@ -26,28 +51,78 @@
  */
 int main(void)
 {
-	int i;
-
 	/* Initialize low-level hardware access */
 	hw_init();
+	/* Record last branches, dumped on HardFault */
+	mtb_init();
+	mtb_start(MTB_WRAP);
+	timer_init(wake_timer);
+#ifdef PROF_ENABLE
+	/* Start cycle counter before the first probe */
+	prof_init(wake_prof);
+#endif
 	/* Initialize peripherals */
 	uart_init();
 	disp_init();
+	link_init(wake_link);
+	btn_init(wake_input);
 
 	uart_puts("\r\n--=={ CowDIN UI }==--  ");
 
 	disp_pos(0, 0); disp_puts("COWDIN-3C-UI");
 	disp_pos(0, 6); disp_puts("yellow :)");
+	disp_flush();
+	LOG_INFO("boot, display SPI at %u Hz", disp_spi_freq());
+
+	timer_start(&led_timer, 250, 250, led_blink, 0);
 
-	// Dummy "blink led" loop
-	while(1)
+	sched_task(TASK_INPUT, task_input);
+	sched_task(TASK_LINK,  link_poll);
+	sched_task(TASK_TIMER, timer_poll);
+#ifdef PROF_ENABLE
+	sched_task(TASK_PROF,  prof_poll);
+#endif
+	/* Logs are sent when nothing else to do */
+	sched_idle(log_drain);
+	/* Process data received during init, if any */
+	sched_post(TASK_LINK);
+	sched_run();
+}
+
+/**
+ * @brief Toggle the LED (called periodically by a software timer)
+ *
+ * @param arg Unused
+ */
+static void led_blink(void *arg)
+{
+	(void)arg;
+	gpio_toggle(GPIO(PIN_LED));
+}
+
+/**
+ * @brief Task used to process button events
+ *
+ * Events are forwarded to the ESP32.
+ */
+static void task_input(void)
+{
+	struct btn_event ev;
+	u8 msg[2];
+
+	while (btn_get(&ev))
 	{
-		reg_wr(0x60000000 + 0x14, (1 << 28));
-		for (i = 0; i < 0x40000; i++)
-			asm volatile("nop");
-		reg_wr(0x60000000 + 0x18, (1 << 28));
-		for (i = 0; i < 0x40000; i++)
-			asm volatile("nop");
+		msg[0] = ev.button;
+		msg[1] = ev.type;
+		link_send(LINK_BUTTON, msg, 2);
 	}
 }
+
+/* Functions called from interrupt handlers to signal events */
+static void wake_input(void) { sched_post(TASK_INPUT); }
+static void wake_link(void)  { sched_post(TASK_LINK);  }
+#ifdef PROF_ENABLE
+static void wake_prof(void)  { sched_post(TASK_PROF);  }
+#endif
+static void wake_timer(void) { sched_post(TASK_TIMER); }
 /* EOF */
@@ -0,0 +1,191 @@
+/**
+ * @file  mtb.c
+ * @brief Driver of the Micro Trace Buffer (MTB) of the Cortex-M0+
+ *
+ * When enabled, the MTB writes one packet of two words into a SRAM buffer
+ * for each non-sequential change of the program flow (branch, exception) :
+ * the source address (bit 0 set for an exception entry or return) and the
+ * destination address (bit 0 set on the first packet after a start). The
+ * CPU is not slowed, only the SRAM bandwidth is shared.
+ *
+ * The trace is sent to the debug UART by mtb_dump(), as text lines starting
+ * with "mtb," (oldest packet first), and decoded by scripts/mtbdec.py. The
+ * HardFault handler freezes and dumps the trace, so the last branches before
+ * a fault can be found without debug probe.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "hardware.h"
+#include "mtb.h"
+#include "uart.h"
+
+/* MASTER.MASK : buffer size is 2^(MASK+4) bytes */
+#define MTB_MASK ((MTB_SIZE == 64)   ? 2 : (MTB_SIZE == 128)  ? 3 : \
+                  (MTB_SIZE == 256)  ? 4 : (MTB_SIZE == 512)  ? 5 : \
+                  (MTB_SIZE == 1024) ? 6 : (MTB_SIZE == 2048) ? 7 : -1)
+#if MTB_MASK < 0
+#error "MTB_SIZE must be a power of 2, from 64 to 2048"
+#endif
+
+void HardFault_Handler(void) __attribute__((naked));
+/* Not static, called by HardFault_Handler (from asm) */
+void mtb_fault(u32 *frame);
+
+/* The MTB requires a buffer aligned on its size */
+static u32  mtb_buf[MTB_SIZE / 4] __attribute__((aligned(MTB_SIZE)));
+static uint mtb_frozen;
+
+/**
+ * @brief Send the content of the trace buffer to the debug UART
+ *
+ * Tracing is stopped during the dump (to not record the dump itself) then
+ * restarted if it was running. A frozen trace is released by the dump.
+ * Output is a header line "mtb,begin,<count>" followed by one line per
+ * packet "mtb,<source>,<destination>" and a final "mtb,end" line.
+ */
+void mtb_dump(void)
+{
+	u32 master, pos;
+	uint i, n, first;
+	u32 *pkt;
+
+	master = reg_rd(MTB_ADDR + 0x04);
+	mtb_stop();
+
+	pos = reg_rd(MTB_ADDR + 0x00);
+	/* Offset of the next packet into the buffer */
+	i = ((pos - ((u32)mtb_buf - reg_rd(MTB_ADDR + 0x0C))) & (MTB_SIZE - 8));
+	if (pos & (1 << 2))
+	{
+		/* Buffer has wrapped, oldest packet is the next one */
+		n     = (MTB_SIZE / 8);
+		first = i;
+	}
+	else
+	{
+		n     = (i / 8);
+		first = 0;
+	}
+
+	uart_printf("\r\nmtb,begin,%u\r\n", n);
+	for (i = 0; i < n; i++)
+	{
+		pkt = &mtb_buf[((first / 4) + (i * 2)) & ((MTB_SIZE / 4) - 1)];
+		uart_printf("mtb,%08x,%08x\r\n", pkt[0], pkt[1]);
+	}
+	uart_printf("mtb,end\r\n");
+	uart_flush(UART_DBG);
+
+	mtb_frozen = 0;
+	/* Restart tracing, without losing the current content */
+	if (master & (1 << 31))
+		reg_wr(MTB_ADDR + 0x04, master);
+}
+
+/**
+ * @brief Stop tracing, and keep the trace until the next dump
+ *
+ * Use this function when a problem is detected (a stall for example) to
+ * keep the branches that lead to it : mtb_start() is refused until the
+ * trace has been sent by mtb_dump().
+ */
+void mtb_freeze(void)
+{
+	mtb_stop();
+	mtb_frozen = 1;
+}
+
+/**
+ * @brief Initialize the MTB (tracing is not started)
+ *
+ */
+void mtb_init(void)
+{
+	reg_wr(MTB_ADDR + 0x04, MTB_MASK);
+	reg_wr(MTB_ADDR + 0x08, 0);
+	/* Buffer position is relative to the SRAM base (BASE register) */
+	reg_wr(MTB_ADDR + 0x00, (u32)mtb_buf - reg_rd(MTB_ADDR + 0x0C));
+	mtb_frozen = 0;
+}
+
+/**
+ * @brief Start tracing into an empty buffer
+ *
+ * @param mode MTB_WRAP to keep the last branches, MTB_ONESHOT to keep the
+ *             first ones
+ * @return integer Zero on success, -1 if the trace is frozen
+ */
+int mtb_start(uint mode)
+{
+	u32 pos;
+
+	if (mtb_frozen)
+		return(-1);
+	mtb_stop();
+
+	pos = (u32)mtb_buf - reg_rd(MTB_ADDR + 0x0C);
+	reg_wr(MTB_ADDR + 0x00, pos);
+	if (mode == MTB_ONESHOT)
+		/* AUTOSTOP when the last packet of the buffer is written */
+		reg_wr(MTB_ADDR + 0x08, (pos + MTB_SIZE - 8) | (1 << 0));
+	else
+		reg_wr(MTB_ADDR + 0x08, 0);
+	reg_wr(MTB_ADDR + 0x04, (1 << 31) | MTB_MASK);
+	return(0);
+}
+
+/**
+ * @brief Stop tracing (content of the buffer is kept)
+ *
+ */
+void mtb_stop(void)
+{
+	reg_wr(MTB_ADDR + 0x04, MTB_MASK);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                          Fault  handler                              -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief HardFault handler, get the exception frame and call mtb_fault()
+ *
+ */
+void HardFault_Handler(void)
+{
+	asm volatile("mrs r0, msp\n"
+	             "bl  mtb_fault\n");
+}
+
+/**
+ * @brief Send the fault context and the trace to the debug UART
+ *
+ * Called from HardFault handler, interrupts are not used : the UART driver
+ * sends bytes by polling when its buffer is full, and uart_flush() waits
+ * for the last ones.
+ *
+ * @param frame Pointer to the exception frame (r0-r3, r12, lr, pc, xpsr)
+ */
+void mtb_fault(u32 *frame)
+{
+	/* Stop tracing first, to keep the branches that lead to the fault */
+	mtb_freeze();
+
+	uart_printf("\r\nmtb,fault,%08x,%08x,%08x\r\n",
+	            frame[6], frame[5], frame[7]);
+	mtb_dump();
+	while(1)
+		;
+}
+/* EOF */
@@ -0,0 +1,33 @@
+/**
+ * @file  mtb.h
+ * @brief Definitions and prototypes for the Micro Trace Buffer (MTB)
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef MTB_H
+#define MTB_H
+#include "types.h"
+
+/* Size of the trace buffer (power of 2, 8 bytes per branch) */
+#define MTB_SIZE 512
+
+#define MTB_WRAP    0 /* Record continuously, keep the last branches  */
+#define MTB_ONESHOT 1 /* Stop recording when the buffer is full       */
+
+void mtb_dump(void);
+void mtb_freeze(void);
+void mtb_init(void);
+int  mtb_start(uint mode);
+void mtb_stop(void);
+
+#endif
+/* EOF */
@@ -0,0 +1,195 @@
+/**
+ * @file  prof.c
+ * @brief Cycle counting probes, using TC4+TC5 as a 32 bits counter
+ *
+ * Statistics can be read at runtime over the debug UART : send 'p' to print
+ * them or 'r' to reset them (see prof_poll). The system is not stopped, the
+ * table is sent by the scheduler like any other task.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "clock.h"
+#include "hardware.h"
+#include "prof.h"
+#include "uart.h"
+
+#ifdef PROF_ENABLE
+
+static const char *prof_names[PROF_COUNT] = {
+	[PROF_DISP_PUTS]  = "disp_puts",
+	[PROF_DISP_CLEAR] = "disp_clear",
+	[PROF_DISP_FLUSH] = "disp_flush",
+	[PROF_UART_DUMP]  = "uart_dump",
+};
+
+static struct prof_stat prof_stats[PROF_COUNT];
+/* Cycles of an empty probe, removed from each measurement */
+static u32 prof_bias;
+
+/**
+ * @brief Add a measurement to the statistics of a probe
+ *
+ * This function can be called from interrupt.
+ *
+ * @param id     Index of the probe (PROF_xxx)
+ * @param cycles Duration of the measured region (in CPU cycles)
+ */
+void prof_add(uint id, u32 cycles)
+{
+	struct prof_stat *s;
+	u32 primask;
+
+	if (id >= PROF_COUNT)
+		return;
+	cycles = (cycles > prof_bias) ? (cycles - prof_bias) : 0;
+
+	s = &prof_stats[id];
+	primask = irq_save();
+	s->count++;
+	if ((s->total + cycles) < s->total)
+		s->total = 0xFFFFFFFF;
+	else
+		s->total += cycles;
+	if (cycles < s->min)
+		s->min = cycles;
+	if (cycles > s->max)
+		s->max = cycles;
+	irq_restore(primask);
+}
+
+/**
+ * @brief Print the statistics of all probes to the debug UART
+ *
+ * Values are in CPU cycles, the current CPU frequency is printed first to
+ * convert them. Average is total / count.
+ */
+void prof_dump(void)
+{
+	struct prof_stat s;
+	uint i;
+
+	uart_printf("\r\nprof cpu=%u Hz bias=%u\r\n", clk_cpu_freq(), prof_bias);
+	uart_printf("%-12s %10s %10s %10s %10s\r\n",
+	            "probe", "count", "total", "min", "max");
+	for (i = 0; i < PROF_COUNT; i++)
+	{
+		prof_stat(i, &s);
+		uart_printf("%-12s %10u %10u %10u %10u\r\n", prof_names[i],
+		            s.count, s.total, s.count ? s.min : 0, s.max);
+	}
+}
+
+/**
+ * @brief Initialize the cycle counter and the probes
+ *
+ * TC4 and TC5 are chained (COUNT32 mode) and clocked by GCLK0 without
+ * prescaler, so the counter follows the CPU clock (see clock.c).
+ *
+ * @param wake Function called (from interrupt) when a command is received
+ */
+void prof_init(void (*wake)(void))
+{
+	u32 t;
+	uint i;
+
+	/* Enable TC4 and TC5 clocks (APBCMASK) */
+	reg_set(PM_ADDR + 0x20, (1 << 12) | (1 << 13));
+	/* Connect GCLK0 (CPU clock) to TC4/TC5 */
+	reg16_wr(GCLK_ADDR + 0x02, (1 << 14) | (0 << 8) | 0x1C);
+
+	/* Reset TC4 */
+	reg16_wr(TC4_ADDR + 0x00, 0x0001);
+	while (reg16_rd(TC4_ADDR + 0x00) & 0x0001)
+		;
+	/* COUNT32 mode, prescaler DIV1, then enable */
+	reg16_wr(TC4_ADDR + 0x00, (2 << 2));
+	reg16_wr(TC4_ADDR + 0x00, (2 << 2) | (1 << 1));
+	while (reg8_rd(TC4_ADDR + 0x0F) & 0x80)
+		;
+	/* Continuous read synchronization of COUNT */
+	reg16_wr(TC4_ADDR + 0x02, (1 << 15) | (1 << 14) | 0x10);
+	while (reg8_rd(TC4_ADDR + 0x0F) & 0x80)
+		;
+
+	/* Measure the cost of an empty probe */
+	prof_bias = 0xFFFFFFFF;
+	for (i = 0; i < 8; i++)
+	{
+		t = prof_now();
+		t = prof_now() - t;
+		if (t < prof_bias)
+			prof_bias = t;
+	}
+	prof_reset();
+
+	uart_rx_hook(UART_DBG, wake);
+}
+
+/**
+ * @brief Process the commands received on the debug UART
+ *
+ * 'p' prints the statistics, 'r' resets them, other bytes are ignored.
+ */
+void prof_poll(void)
+{
+	u8 c;
+
+	while (uart_read(UART_DBG, &c, 1) == 1)
+	{
+		if (c == 'p')
+			prof_dump();
+		else if (c == 'r')
+			prof_reset();
+	}
+}
+
+/**
+ * @brief Clear the statistics of all probes
+ *
+ */
+void prof_reset(void)
+{
+	u32 primask;
+	uint i;
+
+	primask = irq_save();
+	for (i = 0; i < PROF_COUNT; i++)
+	{
+		prof_stats[i].count = 0;
+		prof_stats[i].total = 0;
+		prof_stats[i].min   = 0xFFFFFFFF;
+		prof_stats[i].max   = 0;
+	}
+	irq_restore(primask);
+}
+
+/**
+ * @brief Get a copy of the statistics of one probe
+ *
+ * @param id   Index of the probe (PROF_xxx)
+ * @param stat Pointer to a structure where statistics are copied
+ * @return integer Zero on success, -1 if the probe does not exists
+ */
+int prof_stat(uint id, struct prof_stat *stat)
+{
+	u32 primask;
+
+	if (id >= PROF_COUNT)
+		return(-1);
+	primask = irq_save();
+	*stat = prof_stats[id];
+	irq_restore(primask);
+	return(0);
+}
+
+#endif
+/* EOF */
@@ -0,0 +1,75 @@
+/**
+ * @file  prof.h
+ * @brief Definitions and macros for cycle counting probes
+ *
+ * A probe measures the number of CPU cycles spent between PROF_BEGIN and
+ * PROF_END, using TC4+TC5 as a free-running 32 bits counter clocked by the
+ * CPU clock (GCLK0). Each probe keeps count, total, min and max of its
+ * measurements, see prof_dump().
+ *
+ * Probes are enabled by PROF_ENABLE ("make PROF=1"). Otherwise the macros
+ * are empty and the probes cost nothing.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef PROF_H
+#define PROF_H
+#include "hardware.h"
+#include "types.h"
+
+/* Probe points (names are into prof.c) */
+#define PROF_DISP_PUTS  0
+#define PROF_DISP_CLEAR 1
+#define PROF_DISP_FLUSH 2
+#define PROF_UART_DUMP  3
+#define PROF_COUNT      4
+
+struct prof_stat
+{
+	u32 count;  /* Number of measurements                   */
+	u32 total;  /* Sum of all measurements (saturated)      */
+	u32 min;    /* Shortest measurement                     */
+	u32 max;    /* Longest measurement                      */
+};
+
+#ifdef PROF_ENABLE
+
+#define PROF_BEGIN(id) u32 prof_t_##id = prof_now()
+#define PROF_END(id)   prof_add(id, prof_now() - prof_t_##id)
+
+void prof_add(uint id, u32 cycles);
+void prof_dump(void);
+void prof_init(void (*wake)(void));
+void prof_poll(void);
+void prof_reset(void);
+int  prof_stat(uint id, struct prof_stat *stat);
+
+/**
+ * @brief Read the cycle counter
+ *
+ * @return u32 Current value of the counter (CPU cycles)
+ */
+static inline u32 prof_now(void)
+{
+	/* COUNT is continuously synchronized (READREQ.RCONT) */
+	return(reg_rd(TC4_ADDR + 0x10));
+}
+
+#else
+
+#define PROF_BEGIN(id) do { } while(0)
+#define PROF_END(id)   do { } while(0)
+
+#endif
+
+#endif
+/* EOF */
@@ -0,0 +1,153 @@
+/**
+ * @file  sched.c
+ * @brief Cooperative run-to-completion scheduler (event loop)
+ *
+ * Each task is a function called when an event has been posted for it (by
+ * an interrupt handler or by another task). Several posts before execution
+ * result in one single call. When multiple tasks are ready, the one with the
+ * smallest index runs first ; tasks are never preempted by other tasks. When
+ * no task is ready, the CPU sleeps (WFI) until next interrupt.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "hardware.h"
+#include "sched.h"
+#include "timer.h"
+
+static void (*sched_fn[SCHED_TASKS])(void);
+static void (*sched_idle_fn)(void);
+static volatile uint sched_pending;          /* Bitmask of ready tasks    */
+static volatile u32  sched_post_time[SCHED_TASKS];
+static struct sched_stats stats[SCHED_TASKS];
+static u32 sched_idle_us;
+
+/**
+ * @brief Set a function called before each sleep
+ *
+ * This can be used for background work (like sending logs). The function
+ * is called when no task is ready, then the CPU sleeps until the next
+ * interrupt (at most one SysTick period).
+ *
+ * @param fn Pointer to the function (NULL to disable)
+ */
+void sched_idle(void (*fn)(void))
+{
+	sched_idle_fn = fn;
+}
+
+/**
+ * @brief Get the total time spent sleeping
+ *
+ * @return u32 Time in microseconds
+ */
+u32 sched_idle_time(void)
+{
+	return(sched_idle_us);
+}
+
+/**
+ * @brief Signal an event for a task (can be called from interrupt)
+ *
+ * @param task Index of the task
+ */
+void sched_post(uint task)
+{
+	u32 primask;
+
+	primask = irq_save();
+	if ((sched_pending & (1 << task)) == 0)
+	{
+		sched_pending |= (1 << task);
+		sched_post_time[task] = timer_us();
+	}
+	irq_restore(primask);
+}
+
+/**
+ * @brief Main loop of the scheduler
+ *
+ * This function never returns.
+ */
+void sched_run(void)
+{
+	u32  primask;
+	u32  start, t;
+	uint task, mask;
+
+	while(1)
+	{
+		primask = irq_save();
+		if (sched_pending == 0)
+		{
+			irq_restore(primask);
+			if (sched_idle_fn)
+				sched_idle_fn();
+
+			/* Sleep with interrupts masked : a pending interrupt wakes */
+			/* the CPU, then it is processed when PRIMASK is restored   */
+			primask = irq_save();
+			if (sched_pending == 0)
+			{
+				start = timer_us();
+				asm volatile("wfi");
+				irq_restore(primask);
+				sched_idle_us += timer_us() - start;
+			}
+			else
+				irq_restore(primask);
+			continue;
+		}
+
+		/* Select the ready task with the highest priority */
+		for (task = 0, mask = 1; (sched_pending & mask) == 0; task++)
+			mask <<= 1;
+		sched_pending &= ~mask;
+		start = timer_us();
+		irq_restore(primask);
+
+		t = start - sched_post_time[task];
+		if (t > stats[task].lat_max)
+			stats[task].lat_max = t;
+
+		if (sched_fn[task])
+			sched_fn[task]();
+
+		t = timer_us() - start;
+		stats[task].runs++;
+		stats[task].run_time += t;
+		if (t > stats[task].run_max)
+			stats[task].run_max = t;
+	}
+}
+
+/**
+ * @brief Get the statistics of a task
+ *
+ * @param task Index of the task
+ * @return struct* Pointer to the statistics structure
+ */
+const struct sched_stats *sched_stats(uint task)
+{
+	return(&stats[task]);
+}
+
+/**
+ * @brief Register a task
+ *
+ * @param task Index of the task (0 to SCHED_TASKS - 1), also its priority
+ * @param fn   Function called when an event is posted for this task
+ */
+void sched_task(uint task, void (*fn)(void))
+{
+	sched_fn[task] = fn;
+}
+/* EOF */
@@ -0,0 +1,39 @@
+/**
+ * @file  sched.h
+ * @brief Definitions and prototypes for the event-loop scheduler
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef SCHED_H
+#define SCHED_H
+#include "types.h"
+
+/* Max number of tasks, the index of a task is also its priority (0 = max) */
+#define SCHED_TASKS 8
+
+struct sched_stats
+{
+	u32 runs;      /* Number of executions                          */
+	u32 run_time;  /* Total execution time (us)                     */
+	u32 run_max;   /* Longest execution (us)                        */
+	u32 lat_max;   /* Longest delay between post and execution (us) */
+};
+
+void sched_idle(void (*fn)(void));
+u32  sched_idle_time(void);
+void sched_post(uint task);
+void sched_run(void);
+const struct sched_stats *sched_stats(uint task);
+void sched_task(uint task, void (*fn)(void));
+
+#endif
+/* EOF */
@@ -92,6 +92,17 @@ Reset_Handler:
     str    r0, [r2, r3]
     bgt    .copy_loop
 .copy_end:
+    /* Clear .bss section */
+    ldr    r1, =_szero
+    ldr    r2, =_ezero
+    movs   r0, #0
+.zero_loop:
+    cmp    r1, r2
+    bhs    .zero_end
+    str    r0, [r1]
+    adds   r1, #4
+    b      .zero_loop
+.zero_end:
     /* Call C code entry ("main" function) */
     bl  main
 
@@ -0,0 +1,360 @@
+/**
+ * @file  timer.c
+ * @brief Monotonic time base (SysTick) and software timers
+ *
+ * SysTick interrupt is used to count milliseconds, and the current value of
+ * the SysTick counter gives the microseconds. Software timers are stored
+ * into a hierarchical timer wheel : 4 levels of 64 slots, with a resolution
+ * of 1ms, 64ms, 4s and 262s. Start, stop and expiration of a timer are O(1),
+ * timers of upper levels are moved (cascaded) to lower levels when their
+ * expiration time approaches. Callbacks are called by timer_poll(), from
+ * the main loop (not from interrupt).
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include "hardware.h"
+#include "timer.h"
+
+#define SYST_ADDR ((u32)0xE000E010)
+#define SCB_ICSR  ((u32)0xE000ED04)
+
+/* Frequency of the SysTick clock (CPU clock) after reset (see clock.c) */
+#define TIMER_CLK 48000000
+
+#define WHEEL_BITS  6
+#define WHEEL_SIZE  (1 << WHEEL_BITS)
+#define WHEEL_MASK  (WHEEL_SIZE - 1)
+#define WHEEL_LEVEL 4
+
+static void timer_cascade(uint level);
+static void timer_insert(struct timer *t);
+static void timer_update_due(void);
+
+static volatile u32 timer_tick;  /* Incremented by SysTick (ms)     */
+static u32 timer_load;           /* SysTick reload value            */
+static u32 timer_us_mul;         /* SysTick cycles to us multiplier */
+static u32 timer_carry;          /* Part of ms kept on clock change */
+static volatile u32 timer_due;   /* Next time timer_poll has work   */
+static void (*timer_wake)(void);
+static u32 wheel_now;            /* Last time processed by wheel    */
+static struct timer *wheel[WHEEL_LEVEL][WHEEL_SIZE];
+
+/**
+ * @brief Initialize SysTick and software timers
+ *
+ * @param wake Function called (from interrupt) when timer_poll() must be
+ *             called to process expired timers (can be NULL)
+ */
+void timer_init(void (*wake)(void))
+{
+	timer_tick = 0;
+	timer_carry = 0;
+	timer_wake = wake;
+	wheel_now  = 0;
+	timer_due  = WHEEL_SIZE;
+
+	/* SysTick : reload value, clear counter, then enable (CPU clock, IRQ) */
+	timer_clock(TIMER_LOAD(TIMER_CLK), TIMER_US_MUL(TIMER_CLK));
+	reg_wr(SYST_ADDR + 0x00, (1 << 2) | (1 << 1) | (1 << 0));
+}
+
+/**
+ * @brief Update SysTick after a change of CPU clock
+ *
+ * Values are computed at compile time with TIMER_LOAD() and TIMER_US_MUL()
+ * macros because the CPU has no divider. SysTick restarts a millisecond, so
+ * the elapsed part of the current one (converted with the previous clock) is
+ * kept into a carry, added by timer_us(). When the carry reaches 1ms, the
+ * millisecond counter is advanced.
+ *
+ * @param load   SysTick reload value, see TIMER_LOAD()
+ * @param us_mul Multiplier to convert cycles to us, see TIMER_US_MUL()
+ */
+void timer_clock(u32 load, u32 us_mul)
+{
+	u32 primask;
+	u32 cnt;
+
+	primask = irq_save();
+	if (timer_load)
+	{
+		cnt = reg_rd(SYST_ADDR + 0x08);
+		/* If counter reloaded, the pending interrupt counts the full ms */
+		if (reg_rd(SCB_ICSR) & (1 << 26))
+			cnt = reg_rd(SYST_ADDR + 0x08);
+		timer_carry += ((timer_load - cnt) * timer_us_mul) >> 21;
+		if (timer_carry >= 1000)
+		{
+			timer_carry -= 1000;
+			timer_tick++;
+		}
+	}
+	timer_load   = load;
+	timer_us_mul = us_mul;
+	reg_wr(SYST_ADDR + 0x04, load);
+	reg_wr(SYST_ADDR + 0x08, 0);
+	irq_restore(primask);
+}
+
+/**
+ * @brief Wait for a delay in milliseconds
+ *
+ * @param ms Delay in milliseconds (the wait is at least this duration)
+ */
+void timer_delay_ms(u32 ms)
+{
+	u32 start = timer_ms();
+
+	/* Plus one because current millisecond is already started */
+	while ((timer_ms() - start) < (ms + 1))
+		;
+}
+
+/**
+ * @brief Wait for a delay in microseconds
+ *
+ * @param us Delay in microseconds (max 2^31)
+ */
+void timer_delay_us(u32 us)
+{
+	u32 start = timer_us();
+
+	while ((timer_us() - start) < us)
+		;
+}
+
+/**
+ * @brief Get the time since boot, in milliseconds
+ *
+ * @return u32 Time in milliseconds (wraps after 49 days)
+ */
+u32 timer_ms(void)
+{
+	return(timer_tick);
+}
+
+/**
+ * @brief Get the time since boot, in microseconds
+ *
+ * @return u32 Time in microseconds (wraps after 71 minutes)
+ */
+u32 timer_us(void)
+{
+	u32 primask;
+	u32 ms, cnt, us;
+
+	primask = irq_save();
+	ms  = timer_tick;
+	cnt = reg_rd(SYST_ADDR + 0x08);
+	/* If counter reloaded but interrupt not processed yet */
+	if (reg_rd(SCB_ICSR) & (1 << 26))
+	{
+		cnt = reg_rd(SYST_ADDR + 0x08);
+		ms++;
+	}
+	us = (((timer_load - cnt) * timer_us_mul) >> 21) + timer_carry;
+	irq_restore(primask);
+
+	return((ms * 1000) + us);
+}
+
+/**
+ * @brief Process expired software timers
+ *
+ * This function must be called from the main loop. Callbacks of expired
+ * timers are called from here.
+ */
+void timer_poll(void)
+{
+	struct timer *t;
+	struct timer **slot;
+	u32 now = timer_tick;
+
+	while (wheel_now != now)
+	{
+		wheel_now++;
+		/* Move timers from upper levels when lower level wraps */
+		if ((wheel_now & WHEEL_MASK) == 0)
+			timer_cascade(1);
+
+		slot = &wheel[0][wheel_now & WHEEL_MASK];
+		while ((t = *slot) != 0)
+		{
+			timer_stop(t);
+			if (t->period)
+			{
+				t->expire += t->period;
+				if ((s32)(t->expire - wheel_now) <= 0)
+					t->expire = wheel_now + 1;
+				timer_insert(t);
+			}
+			t->cb(t->arg);
+		}
+	}
+	timer_update_due();
+	/* SysTick may have passed the new due time during the poll */
+	if (timer_wake && ((s32)(timer_tick - timer_due) >= 0))
+		timer_wake();
+}
+
+/**
+ * @brief Test if a timer is running
+ *
+ * @param t Pointer to the timer structure
+ * @return integer Non-zero value if timer is running
+ */
+int timer_running(struct timer *t)
+{
+	return(t->pprev != 0);
+}
+
+/**
+ * @brief Start a software timer
+ *
+ * If the timer is already running, it is restarted. This function must not
+ * be called from interrupt.
+ *
+ * @param t      Pointer to the timer structure
+ * @param delay  Delay before first expiration, in ms (1 to TIMER_MAX)
+ * @param period Period for next expirations in ms, zero for one-shot timer
+ * @param cb     Function called on expiration
+ * @param arg    Argument given to the callback
+ */
+void timer_start(struct timer *t, u32 delay, u32 period,
+                 void (*cb)(void *arg), void *arg)
+{
+	if (t->pprev)
+		timer_stop(t);
+	if (delay == 0)
+		delay = 1;
+	else if (delay > TIMER_MAX)
+		delay = TIMER_MAX;
+
+	t->expire = timer_tick + delay;
+	t->period = period;
+	t->cb     = cb;
+	t->arg    = arg;
+	timer_insert(t);
+
+	if ((s32)(t->expire - timer_due) < 0)
+	{
+		timer_due = t->expire;
+		/* Expiration time may be reached before timer_due updated */
+		if (timer_wake && ((s32)(timer_tick - timer_due) >= 0))
+			timer_wake();
+	}
+}
+
+/**
+ * @brief Stop a software timer
+ *
+ * @param t Pointer to the timer structure
+ */
+void timer_stop(struct timer *t)
+{
+	if (t->pprev == 0)
+		return;
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->next  = 0;
+	t->pprev = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                                                                      -- */
+/* --                       Private  functions                             -- */
+/* --                                                                      -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Move timers of one slot to lower levels
+ *
+ * The current slot of the level is emptied, and each timer is inserted again
+ * according to its remaining delay. When this level also wraps, the upper
+ * level is cascaded first.
+ *
+ * @param level Index of the level to cascade (1 to WHEEL_LEVEL - 1)
+ */
+static void timer_cascade(uint level)
+{
+	struct timer *t;
+	struct timer **slot;
+	uint idx;
+
+	idx = (wheel_now >> (level * WHEEL_BITS)) & WHEEL_MASK;
+	if ((idx == 0) && ((level + 1) < WHEEL_LEVEL))
+		timer_cascade(level + 1);
+
+	slot = &wheel[level][idx];
+	while ((t = *slot) != 0)
+	{
+		timer_stop(t);
+		timer_insert(t);
+	}
+}
+
+/**
+ * @brief Insert a timer into the wheel, according to its expiration time
+ *
+ * @param t Pointer to the timer structure
+ */
+static void timer_insert(struct timer *t)
+{
+	struct timer **slot;
+	u32  delta = t->expire - wheel_now;
+	uint level;
+
+	for (level = 0; level < (WHEEL_LEVEL - 1); level++)
+		if (delta < (1UL << ((level + 1) * WHEEL_BITS)))
+			break;
+	slot = &wheel[level][(t->expire >> (level * WHEEL_BITS)) & WHEEL_MASK];
+
+	t->next  = *slot;
+	t->pprev = slot;
+	if (t->next)
+		t->next->pprev = &t->next;
+	*slot = t;
+}
+
+/**
+ * @brief Compute the next time timer_poll() has something to do
+ *
+ * This is the next non-empty slot of the first level, or the next wrap of
+ * the first level (cascade of upper levels).
+ */
+static void timer_update_due(void)
+{
+	uint i;
+
+	for (i = 1; i < WHEEL_SIZE; i++)
+	{
+		if (((wheel_now + i) & WHEEL_MASK) == 0)
+			break;
+		if (wheel[0][(wheel_now + i) & WHEEL_MASK])
+			break;
+	}
+	timer_due = wheel_now + i;
+}
+
+/**
+ * @brief Interrupt handler for SysTick
+ *
+ */
+void SysTick_Handler(void)
+{
+	timer_tick++;
+	/* Due time can be already passed when updated late by timer_poll */
+	if (timer_wake && ((s32)(timer_tick - timer_due) >= 0))
+		timer_wake();
+}
+/* EOF */
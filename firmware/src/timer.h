@@ -0,0 +1,52 @@
+/**
+ * @file  timer.h
+ * @brief Definitions and prototypes for time base and software timers
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef TIMER_H
+#define TIMER_H
+#include "types.h"
+
+/* SysTick reload value for a 1ms period with a clock of f Hz */
+#define TIMER_LOAD(f)   ((((f) + 500) / 1000) - 1)
+/* Multiplier to convert SysTick cycles to us : (cycles * MUL) >> 21 */
+#define TIMER_US_MUL(f) ((u32)((((unsigned long long)1 << 21) * 1000000 + (f) - 1) / (f)))
+
+/* Max delay of a software timer (in ms, about 4.6 hours) */
+#define TIMER_MAX 0x00FFFFFF
+
+/* Timer structures must be zeroed before first use (static or bss) */
+struct timer
+{
+	struct timer  *next;
+	struct timer **pprev;  /* Pointer to the pointer to this timer */
+	u32  expire;           /* Time of expiration (ms)              */
+	u32  period;           /* Period (ms), zero for one-shot       */
+	void (*cb)(void *arg); /* Function called on expiration        */
+	void *arg;
+};
+
+void timer_clock(u32 load, u32 us_mul);
+void timer_delay_ms(u32 ms);
+void timer_delay_us(u32 us);
+void timer_init(void (*wake)(void));
+u32  timer_ms(void);
+void timer_poll(void);
+int  timer_running(struct timer *t);
+void timer_start(struct timer *t, u32 delay, u32 period,
+                 void (*cb)(void *arg), void *arg);
+void timer_stop(struct timer *t);
+u32  timer_us(void);
+
+#endif
+/* EOF */
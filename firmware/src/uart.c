@@ -13,17 +13,90 @@
  * with this program, see LICENSE.md file for more details.
  * This program is distributed WITHOUT ANY WARRANTY.
  */
+#include "fmt.h"
 #include "hardware.h"
+#include "prof.h"
 #include "uart.h"
 
-#define UART_BAUD    9600
-#define UART_GCLK 8000000
-#define CONF_BAUD_RATE  (65536 - ((65536 * 16.0f * UART_BAUD) / UART_GCLK))
+/* Default baudrate of both ports */
+#define UART_BAUD 9600
+/* Max error allowed for baudrate (in 1/100 of percent) */
+#define UART_BAUD_ERR 300
+
+/* Size of transmit and receive buffers (must be a power of 2) */
+#define UART_TX_SIZE 256
+#define UART_RX_SIZE_DBG  64
+#define UART_RX_SIZE_SYS 256
+
+/* State of one UART port */
+struct uart_port
+{
+	u32 addr;
+	u8  gclk_id;   /* Identifier of the SERCOM core clock into GCLK */
+	u32 baud;      /* Requested baudrate (0 if not configured)      */
+	u8  *tx_buf;
+	volatile uint tx_head; /* Next byte to write (updated by thread) */
+	volatile uint tx_tail; /* Next byte to send  (updated by ISR)    */
+	uint tx_sent; /* Set when a byte has been written to DATA */
+	u8  *rx_buf;
+	uint rx_mask;
+	volatile uint rx_head; /* Next byte to write (updated by ISR)    */
+	volatile uint rx_tail; /* Next byte to read  (updated by thread) */
+	uint policy;
+	void (*rx_hook)(void); /* Called (from ISR) on each received byte */
+	struct uart_stats stats;
+};
+
+/* Configuration of baudrate generator */
+struct uart_baud
+{
+	u8  gclk;  /* Generic clock generator               */
+	u8  sampr; /* Sample rate and mode (CTRLA.SAMPR)    */
+	u16 baud;  /* Value of BAUD register                */
+	u32 rate;  /* Real baudrate obtained with this conf */
+};
+
+/* Generic clock generators that can be used by UART */
+static const struct
+{
+	u8  gen;
+	u32 freq;
+} uart_gclk[2] = {
+	{ 1,  8000000 }, /* GCLK1 : OSC8M   */
+	{ 7, 48000000 }, /* GCLK7 : DFLL48M */
+};
+
+/* Set when DFLL48M (GCLK7) is running, see uart_clock() */
+static uint uart_dfll = 1;
 
 static const u8 hex[16] = "0123456789ABCDEF";
 
 static void uart_init_dbg(void);
 static void uart_init_sys(void);
+static int  uart_baud_arith(u32 fref, uint s, u32 rate, struct uart_baud *cfg);
+static int  uart_baud_frac (u32 fref, uint s, u32 rate, struct uart_baud *cfg);
+static u32  uart_baud_best(u32 rate, uint dfll, struct uart_baud *cfg_best,
+                           int *err);
+static u32  uart_div(u32 n, u32 d);
+static void uart_fmt_put(char c);
+static struct uart_port *uart_port(u32 addr);
+static RAMFUNC void uart_rx_isr(struct uart_port *port);
+static void uart_tx(struct uart_port *port, u8 c);
+static RAMFUNC void uart_tx_isr(struct uart_port *port);
+
+static u8 uart_dbg_tx[UART_TX_SIZE];
+static u8 uart_sys_tx[UART_TX_SIZE];
+static u8 uart_dbg_rx[UART_RX_SIZE_DBG];
+static u8 uart_sys_rx[UART_RX_SIZE_SYS];
+
+static struct uart_port uart_ports[2] = {
+	{ .addr = UART_DBG, .gclk_id = 0x16,
+	  .tx_buf = uart_dbg_tx, .policy = UART_TX_BLOCK,
+	  .rx_buf = uart_dbg_rx, .rx_mask = (UART_RX_SIZE_DBG - 1) },
+	{ .addr = UART_SYS, .gclk_id = 0x17,
+	  .tx_buf = uart_sys_tx, .policy = UART_TX_BLOCK,
+	  .rx_buf = uart_sys_rx, .rx_mask = (UART_RX_SIZE_SYS - 1) },
+};
 
 /**
  * @brief Send end-of-line string CR-LF over UART
@@ -42,6 +115,254 @@ void uart_init(void)
 {
 	uart_init_dbg();
 	uart_init_sys();
+	/* Configure baudrate, and enable ports */
+	uart_set_baud(UART_DBG, UART_BAUD, 0);
+	uart_set_baud(UART_SYS, UART_BAUD, 0);
+
+	/* Enable RXC (Receive Complete) interrupts */
+	reg8_wr(UART_DBG + 0x16, 0x04);
+	reg8_wr(UART_SYS + 0x16, 0x04);
+	/* Enable SERCOM2 and SERCOM3 interrupts into NVIC */
+	reg_wr(NVIC_ADDR + 0x00, (1 << 11) | (1 << 12));
+}
+
+/**
+ * @brief Get the number of received bytes waiting into buffer
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @return integer Number of bytes that can be read
+ */
+int uart_available(u32 port)
+{
+	struct uart_port *p = uart_port(port);
+
+	return( (p->rx_head - p->rx_tail) & p->rx_mask );
+}
+
+/**
+ * @brief Read received bytes (without waiting)
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param buf  Pointer to a buffer where received bytes are copied
+ * @param len  Maximum number of bytes to read
+ * @return integer Number of bytes copied into buffer
+ */
+int uart_read(u32 port, u8 *buf, int len)
+{
+	struct uart_port *p = uart_port(port);
+	uint head, tail;
+	int n;
+
+	head = p->rx_head;
+	tail = p->rx_tail;
+	for (n = 0; (n < len) && (tail != head); n++)
+	{
+		buf[n] = p->rx_buf[tail];
+		tail = (tail + 1) & p->rx_mask;
+	}
+	/* Release space into buffer only after bytes have been copied */
+	p->rx_tail = tail;
+	return(n);
+}
+
+/**
+ * @brief Get received bytes directly into the receive buffer (no copy)
+ *
+ * Only bytes that are contiguous into the ring buffer are returned, when
+ * they wrap at the end of it the remaining part is returned by the next
+ * call. The bytes stay into the buffer (and their space is not available
+ * for reception) until uart_rx_release() is called.
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param data Pointer to a variable where address of the bytes is stored
+ * @param len  Maximum number of bytes
+ * @return integer Number of contiguous bytes available at this address
+ */
+int uart_rx_span(u32 port, const u8 **data, int len)
+{
+	struct uart_port *p = uart_port(port);
+	uint head, tail;
+	int n;
+
+	head = p->rx_head;
+	tail = p->rx_tail;
+	if (head >= tail)
+		n = head - tail;
+	else
+		n = (p->rx_mask + 1) - tail;
+
+	*data = &p->rx_buf[tail];
+	return((n < len) ? n : len);
+}
+
+/**
+ * @brief Release received bytes obtained with uart_rx_span()
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param len  Number of bytes to release (at most the span length)
+ */
+void uart_rx_release(u32 port, int len)
+{
+	struct uart_port *p = uart_port(port);
+
+	p->rx_tail = (p->rx_tail + len) & p->rx_mask;
+}
+
+/**
+ * @brief Wait until all bytes into the transmit buffer of a port are sent
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ */
+void uart_flush(u32 port)
+{
+	struct uart_port *p = uart_port(port);
+	u32 primask;
+
+	while (p->tx_tail != p->tx_head)
+	{
+		/* Send bytes here if interrupts can not be used */
+		primask = irq_save();
+		uart_tx_isr(p);
+		irq_restore(primask);
+	}
+	/* Wait end of last byte (TXC) */
+	if (p->tx_sent)
+	{
+		while ( (reg8_rd(p->addr + 0x18) & 0x02) == 0)
+			;
+		p->tx_sent = 0;
+	}
+}
+
+/**
+ * @brief Select the behavior of transmit functions when buffer is full
+ *
+ * @param port   Address of the UART port (UART_DBG or UART_SYS)
+ * @param policy UART_TX_BLOCK, UART_TX_DROP or UART_TX_OVERWRITE
+ */
+void uart_policy(u32 port, uint policy)
+{
+	uart_port(port)->policy = policy;
+}
+
+/**
+ * @brief Set a function called when a byte is received
+ *
+ * The hook is called from the UART interrupt, it should only signal the
+ * reception (for example with sched_post) and not read the data itself.
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param hook Pointer to the function (NULL to disable)
+ */
+void uart_rx_hook(u32 port, void (*hook)(void))
+{
+	uart_port(port)->rx_hook = hook;
+}
+
+/**
+ * @brief Test if a baudrate can be reached, without changing any port
+ *
+ * Both ports use the same generic clocks, so the result is the same for
+ * each of them. The configuration is computed as uart_set_baud() does.
+ *
+ * @param rate Requested baudrate (bits per second)
+ * @param err  Pointer to an integer where error is stored (or NULL), in 1/100
+ *             of percent (positive when real rate is above requested one)
+ * @return u32 Real baudrate, or zero if rate can not be reached
+ */
+u32 uart_baud_check(u32 rate, int *err)
+{
+	struct uart_baud cfg;
+
+	return(uart_baud_best(rate, uart_dfll, &cfg, err));
+}
+
+/**
+ * @brief Configure the baudrate of one UART port
+ *
+ * The configuration with the smallest error is used (see uart_baud_best),
+ * GCLK7 is used only when DFLL48M is running. Pending bytes are sent (at the
+ * previous rate) before the port is reconfigured.
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param rate Requested baudrate (bits per second)
+ * @param err  Pointer to an integer where error is stored (or NULL), in 1/100
+ *             of percent (positive when real rate is above requested one)
+ * @return u32 Real baudrate, or zero if rate can not be reached
+ */
+u32 uart_set_baud(u32 port, u32 rate, int *err)
+{
+	struct uart_port *p = uart_port(port);
+	struct uart_baud best;
+
+	if (uart_baud_best(rate, uart_dfll, &best, err) == 0)
+		return(0);
+
+	/* Send pending bytes, then disable UART */
+	uart_flush(port);
+	reg_wr(p->addr + 0x00, reg_rd(p->addr + 0x00) & ~(1 << 1));
+	while (reg_rd(p->addr + 0x1C) & 0x02)
+		;
+	/* Set GCLK for this SERCOM */
+	gclk_select(p->gclk_id, best.gclk);
+	/* Set sample rate and BAUD */
+	reg_wr(p->addr + 0x00, (reg_rd(p->addr + 0x00) & ~(7 << 13)) |
+	                       (best.sampr << 13));
+	reg16_wr(p->addr + 0x0C, best.baud);
+	/* Set ENABLE into CTRLA */
+	reg_set(p->addr + 0x00, (1 << 1));
+	while (reg_rd(p->addr + 0x1C) & 0x02)
+		;
+
+	p->baud = rate;
+	return(best.rate);
+}
+
+/**
+ * @brief Get the free space into transmit buffer
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @return integer Number of bytes that can be written without waiting
+ */
+int uart_space(u32 port)
+{
+	struct uart_port *p = uart_port(port);
+
+	return( (p->tx_tail - p->tx_head - 1) & (UART_TX_SIZE - 1) );
+}
+
+/**
+ * @brief Get statistics of a port (dropped bytes, buffer usage)
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @return struct uart_stats* Pointer to the statistics of the port
+ */
+const struct uart_stats *uart_stats(u32 port)
+{
+	return( &uart_port(port)->stats );
+}
+
+/**
+ * @brief Send a buffer over one UART port
+ *
+ * Bytes are copied into the transmit buffer of the port and sent by
+ * interrupt. This function only waits when the buffer is full and the port
+ * policy is UART_TX_BLOCK.
+ *
+ * @param port Address of the UART port (UART_DBG or UART_SYS)
+ * @param data Pointer to the bytes to send
+ * @param len  Number of bytes to send
+ */
+void uart_write(u32 port, const u8 *data, int len)
+{
+	struct uart_port *p = uart_port(port);
+
+	while (len > 0)
+	{
+		uart_tx(p, *data);
+		data++;
+		len--;
+	}
 }
 
 /**
@@ -64,11 +385,7 @@ static void uart_init_dbg(void)
 	/* Configure UART */
 	reg_wr(UART_DBG + 0x00, 0x40100004);
 	reg_wr(UART_DBG + 0x04, 0x00030000);
-	/* Configure Baudrate */
-	reg_wr(UART_DBG + 0x0C, CONF_BAUD_RATE);
-
-	/* Set ENABLE into CTRLA */
-	reg_set( (UART_DBG + 0x00), (1 << 1) );
+	/* Baudrate is set (and port enabled) by uart_set_baud() */
 }
 
 /**
@@ -91,29 +408,78 @@ static void uart_init_sys(void)
 	/* Configure UART */
 	reg_wr(UART_SYS + 0x00, 0x40100004);
 	reg_wr(UART_SYS + 0x04, 0x00030000);
-	/* Configure Baudrate */
-	reg_wr(UART_SYS + 0x0C, CONF_BAUD_RATE);
+	/* Baudrate is set (and port enabled) by uart_set_baud() */
+}
 
-	/* Set ENABLE into CTRLA */
-	reg_set( (UART_SYS + 0x00), (1 << 1) );
+/**
+ * @brief Send a formatted text-string over console UART
+ *
+ * @param fmt Format string (see fmt_vprint for supported conversions)
+ * @return integer Number of characters sent
+ */
+int uart_printf(const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = fmt_vprint(uart_fmt_put, fmt, ap);
+	va_end(ap);
+	return(len);
 }
 
 /**
- * @brief Send a single byte over UART
+ * @brief Send a single byte over console UART
  *
  * @param c Character (or binary byte) to send
  */
 void uart_putc(unsigned char c)
 {
-	/* Read INTFLAG and wait DRE (Data Register Empty) */
-	while ( (reg_rd(UART_DBG + 0x18) & 0x01) == 0)
-		;
-	/* Write data */
-	reg_wr((UART_DBG + 0x28), c);
+	uart_tx(&uart_ports[0], c);
+}
+
+/**
+ * @brief Test if configured baudrates can be kept with a clock profile
+ *
+ * @param dfll Non-zero if DFLL48M (GCLK7) will be running
+ * @return integer Zero if all ports can be configured, -1 otherwise
+ */
+int uart_clock_check(uint dfll)
+{
+	struct uart_baud cfg;
+	uint i;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (uart_ports[i].baud == 0)
+			continue;
+		if (uart_baud_best(uart_ports[i].baud, dfll, &cfg, 0) == 0)
+			return(-1);
+	}
+	return(0);
+}
+
+/**
+ * @brief Update UART ports after a change of clock profile
+ *
+ * The baudrate of each port is computed again, using only the generic
+ * clocks that are still running. Use uart_clock_check() before the change
+ * to know if all rates can be reached.
+ *
+ * @param dfll Non-zero if DFLL48M (GCLK7) is running
+ */
+void uart_clock(uint dfll)
+{
+	uint i;
+
+	uart_dfll = dfll;
+	for (i = 0; i < 2; i++)
+		if (uart_ports[i].baud)
+			uart_set_baud(uart_ports[i].addr, uart_ports[i].baud, 0);
 }
 
 /**
- * @brief Send a text-string over UART
+ * @brief Send a text-string over console UART
  *
  * @param s Pointer to the null terminated text string
  */
@@ -175,6 +541,7 @@ void uart_dump(u8 *buffer, int len)
 	u8 *p;
 	int pos;
 	int i;
+	PROF_BEGIN(PROF_UART_DUMP);
 
 	p = buffer;
 	pos = 0;
@@ -195,5 +562,338 @@ void uart_dump(u8 *buffer, int len)
 		uart_crlf();
 	}
 	uart_crlf();
+	PROF_END(PROF_UART_DUMP);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                        Private UART functions                        -- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Find the best baudrate configuration for a rate
+ *
+ * All available configurations are computed (GCLK1 or GCLK7 source, 16x or
+ * 8x oversampling, arithmetic or fractional mode) and the one with the
+ * smallest error is selected.
+ *
+ * @param rate Requested baudrate (bits per second)
+ * @param dfll Non-zero if GCLK7 (DFLL48M) can be used
+ * @param cfg_best Pointer to a structure where configuration is stored
+ * @param err  Pointer to an integer where error is stored (or NULL)
+ * @return u32 Real baudrate, or zero if rate can not be reached
+ */
+static u32 uart_baud_best(u32 rate, uint dfll, struct uart_baud *cfg_best,
+                          int *err)
+{
+	struct uart_baud best, cfg;
+	u32 diff, best_diff;
+	uint i, s;
+	int e;
+
+	if (rate == 0)
+		return(0);
+
+	best_diff = 0xFFFFFFFF;
+	for (i = 0; i < 2; i++)
+	{
+		if ((uart_gclk[i].gen == 7) && (dfll == 0))
+			continue;
+		for (s = 16; s >= 8; s >>= 1)
+		{
+			cfg.gclk = uart_gclk[i].gen;
+			if (uart_baud_arith(uart_gclk[i].freq, s, rate, &cfg) == 0)
+			{
+				diff = (cfg.rate > rate) ? (cfg.rate - rate) : (rate - cfg.rate);
+				if (diff < best_diff)
+				{
+					best = cfg;
+					best_diff = diff;
+				}
+			}
+			if (uart_baud_frac(uart_gclk[i].freq, s, rate, &cfg) == 0)
+			{
+				diff = (cfg.rate > rate) ? (cfg.rate - rate) : (rate - cfg.rate);
+				if (diff < best_diff)
+				{
+					best = cfg;
+					best_diff = diff;
+				}
+			}
+		}
+	}
+	if (best_diff == 0xFFFFFFFF)
+		return(0);
+
+	/* Compute error (in 1/100 of percent) */
+	if (best_diff < 400000)
+		e = uart_div(best_diff * 10000, rate);
+	else
+		e = 9999;
+	if (e > UART_BAUD_ERR)
+		return(0);
+	if (best.rate < rate)
+		e = -e;
+	if (err)
+		*err = e;
+	*cfg_best = best;
+	return(best.rate);
+}
+
+/**
+ * @brief Compute baudrate configuration for arithmetic mode
+ *
+ * In arithmetic mode, f = fref * (65536 - BAUD) / (S * 65536)
+ *
+ * @param fref Frequency of the SERCOM core clock
+ * @param s    Number of samples per bit (16 or 8)
+ * @param rate Requested baudrate
+ * @param cfg  Pointer to the configuration to update
+ * @return integer Zero on success, -1 if rate can not be reached
+ */
+static int uart_baud_arith(u32 fref, uint s, u32 rate, struct uart_baud *cfg)
+{
+	u32 a, q, f;
+	uint i;
+
+	a = s * rate;
+	if (a >= fref)
+		return(-1);
+	/* q = (65536 * a / fref) rounded, computed with one more bit */
+	q = 0;
+	for (i = 0; i < 17; i++)
+	{
+		a <<= 1;
+		q <<= 1;
+		if (a >= fref)
+		{
+			a -= fref;
+			q |= 1;
+		}
+	}
+	q = (q + 1) >> 1;
+	if (q == 0)
+		return(-1);
+
+	cfg->sampr = (s == 16) ? 0 : 2;
+	cfg->baud  = 65536 - q;
+	/* Real rate : (fref / S) * q / 65536, in two parts to avoid overflow */
+	f = uart_div(fref, s);
+	cfg->rate = ((f >> 16) * q) + (((f & 0xFFFF) * q) >> 16);
+	return(0);
+}
+
+/**
+ * @brief Compute baudrate configuration for fractional mode
+ *
+ * In fractional mode, f = fref / (S * (BAUD + FP / 8))
+ *
+ * @param fref Frequency of the SERCOM core clock
+ * @param s    Number of samples per bit (16 or 8)
+ * @param rate Requested baudrate
+ * @param cfg  Pointer to the configuration to update
+ * @return integer Zero on success, -1 if rate can not be reached
+ */
+static int uart_baud_frac(u32 fref, uint s, u32 rate, struct uart_baud *cfg)
+{
+	u32 x8, den;
+
+	/* x8 = 8 * (BAUD + FP / 8), rounded */
+	den = s * rate;
+	x8  = uart_div((fref << 3) + (den >> 1), den);
+	/* BAUD must be between 1 and 8191 */
+	if ((x8 < 8) || (x8 > 0xFFFF))
+		return(-1);
+
+	cfg->sampr = (s == 16) ? 1 : 3;
+	cfg->baud  = (x8 >> 3) | ((x8 & 7) << 13);
+	den = s * x8;
+	cfg->rate  = uart_div((fref << 3) + (den >> 1), den);
+	return(0);
+}
+
+/**
+ * @brief Unsigned integer division (shift and subtract)
+ *
+ * The firmware is not linked with libgcc, and Cortex-M0+ has no hardware
+ * divider. This is only used for rare computations (baudrate).
+ *
+ * @param n Numerator
+ * @param d Denominator (must be below 2^31)
+ * @return u32 Quotient
+ */
+static u32 uart_div(u32 n, u32 d)
+{
+	u32 q, r;
+	int i;
+
+	q = 0;
+	r = 0;
+	for (i = 31; i >= 0; i--)
+	{
+		r = (r << 1) | ((n >> i) & 1);
+		if (r >= d)
+		{
+			r -= d;
+			q |= (1UL << i);
+		}
+	}
+	return(q);
+}
+
+/**
+ * @brief Output function used by uart_printf
+ *
+ * @param c Character to send
+ */
+static void uart_fmt_put(char c)
+{
+	uart_tx(&uart_ports[0], c);
+}
+
+/**
+ * @brief Get the state structure of an UART port
+ *
+ * @param addr Address of the UART port (UART_DBG or UART_SYS)
+ * @return struct uart_port* Pointer to the port structure
+ */
+static struct uart_port *uart_port(u32 addr)
+{
+	if (addr == UART_SYS)
+		return(&uart_ports[1]);
+	return(&uart_ports[0]);
+}
+
+/**
+ * @brief Push one byte into the transmit buffer of a port
+ *
+ * @param port Pointer to the port structure
+ * @param c    Byte to send
+ */
+static void uart_tx(struct uart_port *port, u8 c)
+{
+	uint next, used;
+	u32 primask;
+
+	next = (port->tx_head + 1) & (UART_TX_SIZE - 1);
+
+	/* Transmit buffer is full */
+	if (next == port->tx_tail)
+	{
+		if (port->policy == UART_TX_DROP)
+		{
+			port->stats.tx_drop++;
+			return;
+		}
+		if (port->policy == UART_TX_OVERWRITE)
+		{
+			/* Discard the oldest byte (tail is also updated by ISR) */
+			primask = irq_save();
+			if (next == port->tx_tail)
+			{
+				port->tx_tail = (port->tx_tail + 1) & (UART_TX_SIZE - 1);
+				port->stats.tx_drop++;
+			}
+			irq_restore(primask);
+		}
+		while (next == port->tx_tail)
+		{
+			/* Send bytes here if interrupts can not be used */
+			primask = irq_save();
+			uart_tx_isr(port);
+			irq_restore(primask);
+		}
+	}
+
+	port->tx_buf[port->tx_head] = c;
+	port->tx_head = next;
+	/* Enable DRE interrupt to start transfer */
+	reg8_wr(port->addr + 0x16, 0x01);
+
+	used = (next - port->tx_tail) & (UART_TX_SIZE - 1);
+	if (used > port->stats.tx_hwm)
+		port->stats.tx_hwm = used;
+}
+
+/**
+ * @brief Send next byte of the transmit buffer, if UART is ready
+ *
+ * @param port Pointer to the port structure
+ */
+static RAMFUNC void uart_tx_isr(struct uart_port *port)
+{
+	/* Read INTFLAG and test DRE (Data Register Empty) */
+	if ( (reg8_rd(port->addr + 0x18) & 0x01) == 0)
+		return;
+
+	/* Nothing more to send, disable DRE interrupt */
+	if (port->tx_tail == port->tx_head)
+	{
+		reg8_wr(port->addr + 0x14, 0x01);
+		return;
+	}
+	/* Write data */
+	reg16_wr(port->addr + 0x28, port->tx_buf[port->tx_tail]);
+	port->tx_tail = (port->tx_tail + 1) & (UART_TX_SIZE - 1);
+	port->tx_sent = 1;
+}
+
+/**
+ * @brief Store received byte into receive buffer (called by ISR)
+ *
+ * @param port Pointer to the port structure
+ */
+static RAMFUNC void uart_rx_isr(struct uart_port *port)
+{
+	uint next;
+	u16 status;
+	u8 c;
+
+	/* Read INTFLAG and test RXC (Receive Complete) */
+	if ( (reg8_rd(port->addr + 0x18) & 0x04) == 0)
+		return;
+
+	/* Read and clear error flags (STATUS) */
+	status = reg16_rd(port->addr + 0x1A);
+	if (status & 0x07)
+	{
+		if (status & 0x04)
+			port->stats.rx_overrun++;
+		if (status & 0x02)
+			port->stats.rx_frame++;
+		reg16_wr(port->addr + 0x1A, status & 0x07);
+	}
+	/* Read data (clear RXC) */
+	c = reg16_rd(port->addr + 0x28);
+
+	next = (port->rx_head + 1) & port->rx_mask;
+	if (next == port->rx_tail)
+		port->stats.rx_full++;
+	else
+	{
+		port->rx_buf[port->rx_head] = c;
+		port->rx_head = next;
+	}
+	if (port->rx_hook)
+		port->rx_hook();
+}
+
+/**
+ * @brief SERCOM2 (console UART) interrupt handler
+ *
+ */
+RAMFUNC void SERCOM2_Handler(void)
+{
+	uart_rx_isr(&uart_ports[0]);
+	uart_tx_isr(&uart_ports[0]);
+}
+
+/**
+ * @brief SERCOM3 (main UART) interrupt handler
+ *
+ */
+RAMFUNC void SERCOM3_Handler(void)
+{
+	uart_rx_isr(&uart_ports[1]);
+	uart_tx_isr(&uart_ports[1]);
 }
 /* EOF */
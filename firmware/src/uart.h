@@ -21,14 +21,43 @@
 #define UART_DBG SERCOM2_ADDR
 #define UART_SYS SERCOM3_ADDR
 
+/* Behavior of transmit functions when buffer is full */
+#define UART_TX_BLOCK     0 /* Wait for free space             */
+#define UART_TX_DROP      1 /* Discard the new bytes           */
+#define UART_TX_OVERWRITE 2 /* Discard the oldest pending bytes */
+
+struct uart_stats
+{
+	u32  tx_drop;    /* Number of discarded bytes (DROP or OVERWRITE policy) */
+	uint tx_hwm;     /* High-water mark of transmit buffer                   */
+	u32  rx_overrun; /* Number of UART buffer overflows (BUFOVF)             */
+	u32  rx_frame;   /* Number of framing errors (FERR)                      */
+	u32  rx_full;    /* Number of bytes lost because receive buffer is full  */
+};
+
+int  uart_available(u32 port);
+u32  uart_baud_check(u32 rate, int *err);
+void uart_clock(uint dfll);
+int  uart_clock_check(uint dfll);
 void uart_crlf(void);
 void uart_dump(u8 *d, int l);
+void uart_flush(u32 port);
 void uart_init(void);
+void uart_policy(u32 port, uint policy);
+int  uart_printf(const char *fmt, ...);
 void uart_putc(unsigned char c);
 void uart_puts(char *s);
 void uart_puthex  (const u32 c);
 void uart_puthex8 (const u8  c);
 void uart_puthex16(const u16 c);
+int  uart_read(u32 port, u8 *buf, int len);
+void uart_rx_hook(u32 port, void (*hook)(void));
+void uart_rx_release(u32 port, int len);
+int  uart_rx_span(u32 port, const u8 **data, int len);
+u32  uart_set_baud(u32 port, u32 rate, int *err);
+int  uart_space(u32 port);
+const struct uart_stats *uart_stats(u32 port);
+void uart_write(u32 port, const u8 *data, int len);
 
 #endif
 /* EOF */
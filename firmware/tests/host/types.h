@@ -0,0 +1,35 @@
+/**
+ * @file  types.h
+ * @brief Variable types aliases for host tests
+ *
+ * Same types as src/types.h, but with a 32 bits u32 on a 64 bits host (long
+ * is 32 bits on the target only).
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef TYPES_H
+#define TYPES_H
+
+typedef unsigned int   u32;
+typedef unsigned short u16;
+typedef unsigned char  u8;
+typedef signed   char  s8;
+typedef signed   short s16;
+typedef signed   int   s32;
+typedef volatile unsigned int   vu32;
+typedef volatile unsigned short vu16;
+typedef volatile unsigned char  vu8;
+typedef volatile signed   short vs16;
+
+typedef unsigned int uint;
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * @file  test.h
+ * @brief Helpers for host tests (see "make test")
+ *
+ * A test program includes the firmware module(s) to test (the .c file, so
+ * private functions and variables can be used), defines stubs for the other
+ * modules, then reports each failed check with TEST_CHECK.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef TEST_H
+#define TEST_H
+#include <stdio.h>
+
+static int test_fails;
+
+/* Report a failure (file, line and condition) when cond is false */
+#define TEST_CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+		test_fails++; \
+	} } while (0)
+
+/**
+ * @brief Print the result of a test program
+ *
+ * @param name Name of the test program
+ * @return integer Exit code of the program (0 if all checks passed)
+ */
+static inline int test_end(const char *name)
+{
+	if (test_fails)
+		printf("  [FAIL] %s : %d failed check(s)\n", name, test_fails);
+	else
+		printf("  [ OK ] %s\n", name);
+	return(test_fails ? 1 : 0);
+}
+
+#endif
+/* EOF */
@@ -0,0 +1,125 @@
+/**
+ * @file  test_console.c
+ * @brief Host test of the scrolling console (bytes sent for each new line)
+ *
+ * The console is drawn into the real display driver, with the SPI port and
+ * the DMA controller simulated (see test_spi.h). Once the screen is full, a
+ * new line must only send its own page and the start line command : the
+ * lines already on screen are never sent again.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <string.h>
+#include "display.c"
+#include "console.c"
+#include "test.h"
+#include "test_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --                               Tests                                  -- */
+/* -------------------------------------------------------------------------- */
+
+/* Check that the last flush sent one page only, then a start line command */
+static int scroll_ok(uint page, uint line)
+{
+	return((spi.ncmd == 7) &&
+	       (spi.cmd[0] == 0x21) && (spi.cmd[1] <= spi.cmd[2]) &&
+	       (spi.cmd[3] == 0x22) && (spi.cmd[4] == page) &&
+	       (spi.cmd[5] == page) &&
+	       (spi.ndata == (uint)(spi.cmd[2] - spi.cmd[1] + 1)) &&
+	       (spi.cmd[6] == (0x40 | line)) &&
+	       (spi.flush == 1) && (spi.outside == 0));
+}
+
+static void test_fill(void)
+{
+	char s[4] = "L0\n";
+	uint i;
+
+	spi.cs = 1;
+	disp_init();
+	con_init();
+	disp_flush();
+
+	/* Lines are written top to bottom, without scroll */
+	for (i = 0; i < DISP_PAGES; i++)
+	{
+		s[1] = '0' + i;
+		spi_reset();
+		con_puts((i < (DISP_PAGES - 1)) ? s : "L7");
+		disp_flush();
+		TEST_CHECK(spi.ncmd == 6);
+		TEST_CHECK((spi.cmd[4] == i) && (spi.cmd[5] == i));
+		TEST_CHECK(disp_start == 0);
+	}
+}
+
+static void test_scroll(void)
+{
+	/* Screen is full : page 0 is reused, screen starts at page 1 */
+	spi_reset();
+	con_puts("\nL8");
+	disp_flush();
+	TEST_CHECK(scroll_ok(0, 8));
+	TEST_CHECK(spi.ndata <= DISP_WIDTH);
+
+	/* Next one : page 1, screen starts at page 2 */
+	spi_reset();
+	con_puts("\nL9");
+	disp_flush();
+	TEST_CHECK(scroll_ok(1, 16));
+
+	/* Line-feed alone : the old line is cleared, nothing else is sent */
+	spi_reset();
+	con_putc('\n');
+	disp_flush();
+	TEST_CHECK(scroll_ok(2, 24));
+
+	/* Start line wraps with the pages (page 7 reused, start at page 0) */
+	con_puts("\n\n\n\n");
+	disp_flush();
+	spi_reset();
+	con_puts("\nL10");
+	disp_flush();
+	TEST_CHECK(scroll_ok(7, 0));
+}
+
+static void test_wrap(void)
+{
+	char s[DISP_WIDTH + 1];
+	uint n;
+
+	/* A line a bit longer than the screen is wrapped to the next page */
+	n = DISP_WIDTH / disp_width("W") + 1;
+	memset(s, 'W', n);
+	s[n] = 0;
+	TEST_CHECK(disp_width(s) > DISP_WIDTH);
+	spi_reset();
+	con_puts("\n");
+	con_puts(s);
+	disp_flush();
+	/* Two pages (one or two windows), then the start line */
+	TEST_CHECK((spi.ncmd == 7) || (spi.ncmd == 13));
+	TEST_CHECK((spi.cmd[4] == 0) && (spi.cmd[spi.ncmd - 2] == 1));
+	TEST_CHECK(spi.cmd[spi.ncmd - 1] == 0x50);
+	TEST_CHECK(spi.ndata <= 2 * DISP_WIDTH);
+}
+
+int main(void)
+{
+	test_fill();
+	test_scroll();
+	test_wrap();
+
+	return(test_end("console"));
+}
+/* EOF */
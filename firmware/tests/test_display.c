@@ -0,0 +1,278 @@
+/**
+ * @file  test_display.c
+ * @brief Host test of display flush (bytes sent for modified areas)
+ *
+ * The SPI port and the DMA controller are simulated (see test_spi.h). Each
+ * test modifies some columns of the framebuffer and checks the number of
+ * command and data bytes of the next flush.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <string.h>
+#include "display.c"
+#include "test.h"
+#include "test_spi.h"
+
+/* -------------------------------------------------------------------------- */
+/* --                               Tests                                  -- */
+/* -------------------------------------------------------------------------- */
+
+/* Set a range of columns of one page */
+static void draw(uint page, uint x0, uint x1, u8 v)
+{
+	uint x;
+
+	for (x = x0; x <= x1; x++)
+		disp_wr(page, x, v);
+}
+
+/* Check one window command (column and page address) of the flush */
+static int window(uint n, uint x0, uint x1, uint p0, uint p1)
+{
+	const u8 *cmd = &spi.cmd[n * 6];
+
+	return((spi.ncmd >= (n + 1) * 6) &&
+	       (cmd[0] == 0x21) && (cmd[1] == x0) && (cmd[2] == x1) &&
+	       (cmd[3] == 0x22) && (cmd[4] == p0) && (cmd[5] == p1));
+}
+
+static void test_init(void)
+{
+	spi.cs = 1;
+	disp_init();
+	/* Whole configuration and RAM clear sent into one transaction */
+	TEST_CHECK(spi.ndata == DISP_PAGES * DISP_WIDTH);
+	TEST_CHECK(spi.flush == 1);
+	TEST_CHECK(spi.outside == 0);
+	TEST_CHECK(disp_busy() == 0);
+}
+
+static void test_clean(void)
+{
+	/* Nothing modified : no transaction at all */
+	spi_reset();
+	disp_flush();
+	TEST_CHECK(spi.flush == 0);
+	TEST_CHECK((spi.ncmd + spi.ndata) == 0);
+
+	/* Clear of a blank display : no column modified */
+	disp_clear(0xFF);
+	disp_flush();
+	TEST_CHECK((spi.ncmd + spi.ndata) == 0);
+}
+
+static void test_pixel(void)
+{
+	spi_reset();
+	draw(3, 40, 40, 0x10);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata == 1);
+	TEST_CHECK(window(0, 40, 40, 3, 3));
+	TEST_CHECK(spi.data[0] == 0x10);
+
+	/* Sent column is clean */
+	spi_reset();
+	disp_flush();
+	TEST_CHECK((spi.ncmd + spi.ndata) == 0);
+
+	/* Same value written again : not modified */
+	draw(3, 40, 40, 0x10);
+	disp_flush();
+	TEST_CHECK((spi.ncmd + spi.ndata) == 0);
+}
+
+static void test_range(void)
+{
+	/* Range of one page, modified in two parts */
+	spi_reset();
+	draw(2, 10, 19, 0xAA);
+	draw(2, 25, 29, 0x55);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata == 20);
+	TEST_CHECK(window(0, 10, 29, 2, 2));
+	TEST_CHECK(memcmp(spi.data, &fb[2][10], 20) == 0);
+
+	/* Same columns of consecutive pages : one window */
+	spi_reset();
+	draw(4, 60, 69, 0x01);
+	draw(5, 60, 69, 0x02);
+	draw(6, 62, 67, 0x03);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata == 30);
+	TEST_CHECK(window(0, 60, 69, 4, 6));
+	TEST_CHECK(memcmp(&spi.data[20], &fb[6][60], 10) == 0);
+	TEST_CHECK(spi.flush == 1);
+
+	/* Far areas : one window for each (less bytes than one large) */
+	spi_reset();
+	draw(0, 0, 3, 0xFF);
+	draw(7, 100, 103, 0xFF);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 12);
+	TEST_CHECK(spi.ndata == 8);
+	TEST_CHECK(window(0, 0, 3, 0, 0));
+	TEST_CHECK(window(1, 100, 103, 7, 7));
+	TEST_CHECK(spi.flush == 1);
+
+	/* Near areas : 10 + 10 + DISP_WIN_COST bytes sent, not 2 * 30 */
+	spi_reset();
+	draw(0,  0,  9, 0x81);
+	draw(1, 20, 29, 0x81);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 12);
+	TEST_CHECK(spi.ndata == 20);
+
+	/* A clean page between two areas : 3 * 10 sent, not 10 + 10 + 12 */
+	spi_reset();
+	draw(0, 0, 9, 0x18);
+	draw(2, 0, 9, 0x18);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata == 30);
+	TEST_CHECK(window(0, 0, 9, 0, 2));
+	TEST_CHECK(spi.outside == 0);
+}
+
+static uint done_count;
+
+static void done(void)
+{
+	done_count++;
+}
+
+static void test_async(void)
+{
+	/* Two windows : 4 DMA transfers, completion reported once */
+	spi_reset();
+	draw(1, 5, 9, 0x3C);
+	draw(6, 5, 9, 0x3C);
+	dma_check = 4;
+	TEST_CHECK(disp_flush_async(done) == 0);
+	TEST_CHECK(dma_check == 0);
+	TEST_CHECK(done_count == 1);
+	TEST_CHECK(disp_busy() == 0);
+	TEST_CHECK(spi.ndata == 10);
+
+	/* Nothing modified : completion reported too */
+	TEST_CHECK(disp_flush_async(done) == 0);
+	TEST_CHECK(done_count == 2);
+	TEST_CHECK(spi.flush == 1);
+}
+
+static void test_delta(void)
+{
+	/* Only the columns with a new value are sent */
+	spi_reset();
+	disp_delta((const u8 *)"\x11\x20\x08\x00", 4);  /* FILL page 1 with 0 */
+	disp_delta((const u8 *)"\x01\x20\x04\x00\x00\x7E\x00", 7);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata == 1);
+	TEST_CHECK(window(0, 0x22, 0x22, 1, 1));
+
+	/* XOR of the same column : back to blank */
+	spi_reset();
+	TEST_CHECK(disp_delta((const u8 *)"\x21\x22\x01\x7E", 4) == 0);
+	disp_flush();
+	TEST_CHECK((spi.ndata == 1) && (spi.data[0] == 0x00));
+
+	/* Runs : 4 columns set, 6 columns already blank */
+	spi_reset();
+	TEST_CHECK(disp_delta((const u8 *)"\x33\x00\x0A\x04\xFF\x06\x00", 7) == 0);
+	disp_flush();
+	TEST_CHECK(spi.ndata == 4);
+	TEST_CHECK(window(0, 0, 3, 3, 3));
+
+	/* Malformed spans */
+	TEST_CHECK(disp_delta((const u8 *)"\x00\x7F\x02\x00\x00", 5) == -1);
+	TEST_CHECK(disp_delta((const u8 *)"\x00\x00\x02\x00", 4) == -1);
+	TEST_CHECK(disp_delta((const u8 *)"\x30\x00\x02\x03\x00", 5) == -1);
+	TEST_CHECK(disp_delta((const u8 *)"\x00\x00", 2) == -1);
+}
+
+static void test_putc(void)
+{
+	uint wa = (font_idx['A' - 0x20] & 0x0F);
+	uint wb = (font_idx['B' - 0x20] & 0x0F);
+	uint w;
+
+	/* Text of 2 characters : at most the columns of both glyphs */
+	spi_reset();
+	disp_pos(1, 5);
+	disp_putc('A');
+	disp_putc('B');
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK(spi.ndata > 0);
+	TEST_CHECK(spi.ndata <= wa + txt_spacing + wb);
+	TEST_CHECK((spi.cmd[1] >= 8) && (spi.cmd[4] == 5) && (spi.cmd[5] == 5));
+
+	/* Proportional width, with the spacing after each glyph */
+	TEST_CHECK(disp_width("AB") == wa + wb + 2 * txt_spacing);
+	TEST_CHECK(disp_width(" ") == DISP_FONT_SPACE + txt_spacing);
+
+	/* Scaled text : one window on 2 pages, twice the glyph width */
+	disp_clear(0xFF);
+	disp_flush();
+	spi_reset();
+	disp_scale(2);
+	disp_pos(0, 2);
+	disp_putc('A');
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 6);
+	TEST_CHECK((spi.cmd[4] == 2) && (spi.cmd[5] == 3));
+	w = (spi.cmd[2] - spi.cmd[1] + 1);
+	TEST_CHECK(w <= 2 * wa);
+	TEST_CHECK(spi.ndata == 2 * w);
+	TEST_CHECK(disp_width("A") == 2 * (wa + txt_spacing));
+	disp_scale(1);
+}
+
+static void test_scroll(void)
+{
+	/* Scroll only : one command */
+	spi_reset();
+	disp_scroll(8);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 1);
+	TEST_CHECK(spi.ndata == 0);
+	TEST_CHECK(spi.cmd[0] == 0x48);
+	TEST_CHECK(spi.outside == 0);
+
+	/* Sent after the modified content */
+	spi_reset();
+	draw(0, 0, 0, 0x01);
+	disp_scroll(0);
+	disp_flush();
+	TEST_CHECK(spi.ncmd  == 7);
+	TEST_CHECK(spi.ndata == 1);
+	TEST_CHECK(spi.cmd[6] == 0x40);
+	TEST_CHECK(spi.flush == 1);
+}
+
+int main(void)
+{
+	test_init();
+	test_clean();
+	test_pixel();
+	test_range();
+	test_async();
+	test_delta();
+	test_putc();
+	test_scroll();
+
+	return(test_end("display"));
+}
+/* EOF */
@@ -0,0 +1,108 @@
+/**
+ * @file  test_fmt.c
+ * @brief Host test of formatted output (conversions and division by 10)
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "fmt.c"
+#include "test.h"
+
+static char out[128];
+static uint out_len;
+
+static void put(char c)
+{
+	if (out_len < (sizeof(out) - 1))
+		out[out_len++] = c;
+	out[out_len] = 0;
+}
+
+/* Format into "out", then compare with the expected string */
+#define FMT_CHECK(expect, ...) do { \
+	out_len = 0; \
+	out[0]  = 0; \
+	TEST_CHECK((fmt_print(put, __VA_ARGS__) == (int)strlen(expect)) && \
+	           (strcmp(out, expect) == 0)); \
+} while (0)
+
+/* -------------------------------------------------------------------------- */
+/* --                               Tests                                  -- */
+/* -------------------------------------------------------------------------- */
+
+static int divu10_ok(u32 v)
+{
+	uint r;
+
+	return((fmt_divu10(v, &r) == (v / 10)) && (r == (v % 10)));
+}
+
+static void test_divu10(void)
+{
+	uint err = 0;
+	u32  v;
+	int  i;
+
+	/* Small values, largest values, and random ones */
+	for (v = 0; v < 0x100000; v++)
+		err += !divu10_ok(v);
+	for (v = 0xFFFFFFFF; v > 0xFFF00000; v--)
+		err += !divu10_ok(v);
+	for (i = 0; i < 1000000; i++)
+		err += !divu10_ok(((u32)rand() << 16) ^ (u32)rand());
+	TEST_CHECK(err == 0);
+}
+
+static void test_int(void)
+{
+	FMT_CHECK("0", "%d", 0);
+	FMT_CHECK("-2147483648", "%d", (int)0x80000000);
+	FMT_CHECK("4294967295", "%u", 0xFFFFFFFF);
+	FMT_CHECK("12345", "%i", 12345);
+	FMT_CHECK("-42", "%ld", -42L);
+	FMT_CHECK("[   42]", "[%5d]", 42);
+	FMT_CHECK("[42   ]", "[%-5d]", 42);
+	FMT_CHECK("[-0042]", "[%05d]", -42);
+	FMT_CHECK("deadbeef DEADBEEF", "%x %X", 0xDEADBEEF, 0xDEADBEEF);
+	FMT_CHECK("000A", "%04X", 10);
+}
+
+static void test_str(void)
+{
+	FMT_CHECK("a b 100%", "%c %s 100%%", 'a', "b");
+	FMT_CHECK("[  ab]", "[%4s]", "ab");
+	FMT_CHECK("[ab  ]", "[%-4s]", "ab");
+}
+
+static void test_fixed(void)
+{
+	FMT_CHECK("1.50", "%q", 0x00018000);
+	FMT_CHECK("2", "%.0q", 0x00018000);
+	FMT_CHECK("-1.3", "%.1q", -0x00014000);
+	FMT_CHECK("0.0001", "%.4q", 7);
+	FMT_CHECK("3.1416", "%.4q", 205887);
+	FMT_CHECK("[ -0.50]", "[%6q]", -0x8000);
+}
+
+int main(void)
+{
+	srand(1);
+
+	test_divu10();
+	test_int();
+	test_str();
+	test_fixed();
+
+	return(test_end("fmt"));
+}
+/* EOF */
@@ -0,0 +1,431 @@
+/**
+ * @file  test_gfx.c
+ * @brief Host test of drawing primitives, compared with golden bitmaps
+ *
+ * Each test draws into a blank framebuffer, then the pixels of an area are
+ * compared with a golden bitmap ('#' for a pixel set). Pixels outside of the
+ * area must stay clear, and all modified columns must have been reported to
+ * disp_mark(). On mismatch, golden and drawn bitmaps are printed side by side.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <string.h>
+#include "gfx.c"
+#include "test.h"
+
+static u8   fb[DISP_PAGES][DISP_WIDTH];
+static uint fb_min[DISP_PAGES];
+static uint fb_max[DISP_PAGES];
+
+/* Icon of 8x10 pixels, with 2 rows of bytes */
+static const u8 icon[2 * 8] = {
+	0x3C, 0x42, 0x81, 0xA5, 0x81, 0x99, 0x42, 0x3C,
+	0x03, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x03
+};
+
+/* -------------------------------------------------------------------------- */
+/* --                               Stubs                                  -- */
+/* -------------------------------------------------------------------------- */
+
+u8 *disp_fb(uint page)
+{
+	TEST_CHECK(page < DISP_PAGES);
+	return(fb[page]);
+}
+
+void disp_mark(uint page, uint x0, uint x1)
+{
+	TEST_CHECK((page < DISP_PAGES) && (x0 <= x1) && (x1 < DISP_WIDTH));
+	if (x0 < fb_min[page])
+		fb_min[page] = x0;
+	if (x1 > fb_max[page])
+		fb_max[page] = x1;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                              Helpers                                 -- */
+/* -------------------------------------------------------------------------- */
+
+static void fb_reset(void)
+{
+	uint p;
+
+	memset(fb, 0, sizeof(fb));
+	for (p = 0; p < DISP_PAGES; p++)
+	{
+		fb_min[p] = DISP_WIDTH;
+		fb_max[p] = 0;
+	}
+}
+
+static int pixel(uint x, uint y)
+{
+	return((fb[y >> 3][x] >> (y & 7)) & 1);
+}
+
+/**
+ * @brief Compare the framebuffer with a golden bitmap
+ *
+ * @param x0     Horizontal position of the golden bitmap
+ * @param y0     Vertical position of the golden bitmap
+ * @param golden Rows of the bitmap, terminated by a NULL pointer
+ * @return integer Non-zero if the whole framebuffer matches
+ */
+static int match(uint x0, uint y0, const char **golden)
+{
+	uint w = strlen(golden[0]);
+	uint h, x, y;
+	int  ok = 1;
+
+	for (h = 0; golden[h]; h++)
+		;
+	for (y = 0; y < DISP_HEIGHT; y++)
+	{
+		for (x = 0; x < DISP_WIDTH; x++)
+		{
+			if ((x >= x0) && (x < x0 + w) && (y >= y0) && (y < y0 + h))
+				ok &= (pixel(x, y) == (golden[y - y0][x - x0] == '#'));
+			else
+				ok &= (pixel(x, y) == 0);
+			/* Modified columns must be marked */
+			if (fb[y >> 3][x])
+				ok &= ((x >= fb_min[y >> 3]) && (x <= fb_max[y >> 3]));
+		}
+	}
+	if (ok)
+		return(1);
+
+	for (y = y0; y < y0 + h; y++)
+	{
+		printf("  %-*s  ", w, golden[y - y0]);
+		for (x = x0; x < x0 + w; x++)
+			putchar(pixel(x, y) ? '#' : '.');
+		putchar('\n');
+	}
+	return(0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                               Tests                                  -- */
+/* -------------------------------------------------------------------------- */
+
+static void test_pixel(void)
+{
+	static const char *golden[] = {
+		"............",
+		".#..........",
+		"............",
+		"............",
+		"............",
+		"............",
+		"............",
+		"........#...",
+		".........#..",
+		"............",
+		0
+	};
+
+	fb_reset();
+	gfx_pixel(1, 1, GFX_SET);
+	gfx_pixel(5, 3, GFX_SET);
+	gfx_pixel(5, 3, GFX_INV);
+	gfx_pixel(8, 7, GFX_INV);
+	gfx_pixel(9, 8, GFX_SET);
+	gfx_pixel(2, 6, GFX_SET);
+	gfx_pixel(2, 6, GFX_CLR);
+	TEST_CHECK(match(0, 0, golden));
+	/* Only the drawn columns are marked */
+	TEST_CHECK((fb_min[0] == 1) && (fb_max[0] == 8));
+	TEST_CHECK((fb_min[1] == 9) && (fb_max[1] == 9));
+	TEST_CHECK(fb_min[2] > fb_max[2]);
+
+	/* Setting a pixel already set does not mark it */
+	fb_reset();
+	fb[0][3] = 0x01;
+	gfx_pixel(3, 0, GFX_SET);
+	TEST_CHECK(fb_min[0] > fb_max[0]);
+}
+
+static void test_lines(void)
+{
+	static const char *golden[] = {
+		"................",
+		"....#...........",
+		"....#...........",
+		"................",
+		"................",
+		"..############..",
+		"....#...........",
+		"#...#...........",
+		"#...#...........",
+		"###########.....",
+		"#...#...........",
+		"#...#...........",
+		"#...#...........",
+		"................",
+		0
+	};
+
+	fb_reset();
+	gfx_hline( 2, 13, 5, GFX_SET);
+	gfx_hline(10,  1, 9, GFX_SET);
+	gfx_vline( 4,  1, 12, GFX_SET);
+	gfx_vline( 0, 12, 7, GFX_INV);
+	gfx_vline( 4,  3, 4, GFX_CLR);
+	TEST_CHECK(match(0, 0, golden));
+}
+
+static void test_line(void)
+{
+	static const char *golden[] = {
+		"##...........#..",
+		"..##.........#..",
+		"....##.......#..",
+		"......##......#.",
+		"........##....#.",
+		"..........##..#.",
+		"..............#.",
+		"..............#.",
+		".##............#",
+		"...####........#",
+		".......###.....#",
+		"..........##....",
+		0
+	};
+
+	fb_reset();
+	gfx_line( 0,  0, 11,  5, GFX_SET);
+	gfx_line(13,  0, 15, 10, GFX_SET);
+	gfx_line(11, 11,  1,  8, GFX_SET);
+	TEST_CHECK(match(0, 0, golden));
+}
+
+static void test_rect(void)
+{
+	static const char *golden[] = {
+		"................",
+		".##########.....",
+		".#........#..#..",
+		".#.#......#..#..",
+		".#...####.#..#..",
+		".#...####.#..#..",
+		".#........#..#..",
+		".#........#..#..",
+		".#........#..#..",
+		".#........#..#..",
+		".#........#.....",
+		".#........#.....",
+		".##########.....",
+		"................",
+		0
+	};
+
+	fb_reset();
+	gfx_rect( 1, 1, 10, 12, GFX_SET);
+	gfx_rect( 3, 3,  1,  1, GFX_SET);
+	gfx_rect( 5, 4,  4,  2, GFX_SET);
+	gfx_rect(13, 2,  1,  8, GFX_SET);
+	gfx_rect( 0, 0,  0,  5, GFX_SET);
+	TEST_CHECK(match(0, 0, golden));
+}
+
+static void test_fill(void)
+{
+	static const char *golden[] = {
+		"............",
+		"............",
+		".....######.",
+		".....######.",
+		".....######.",
+		".....######.",
+		"..###.....#.",
+		"..###.....#.",
+		"#####.....#.",
+		"#..##.....#.",
+		"#..##.....#.",
+		"####.######.",
+		"####........",
+		"####........",
+		"####........",
+		"####........",
+		0
+	};
+
+	fb_reset();
+	gfx_fill(2, 6, 8,  5, GFX_SET);
+	gfx_fill(5, 2, 6, 10, GFX_INV);
+	gfx_fill(0, 8, 4,  8, GFX_SET);
+	gfx_fill(1, 9, 2,  2, GFX_CLR);
+	TEST_CHECK(match(0, 0, golden));
+}
+
+/* Icon drawn at a position not aligned on a page, with each mode */
+static void test_blit(void)
+{
+	static const char *clr[] = {
+		"....########",
+		"....########",
+		"....########",
+		"........####",
+		"............",
+		"............",
+		"............",
+		"............",
+		"............",
+		"............",
+		"........####",
+		".....#.##.##",
+		"....#####.##",
+		"....########",
+		"....########",
+		"....########",
+		0
+	};
+	static const char *set[] = {
+		"....########",
+		"....########",
+		"....########",
+		"....########",
+		"...#....#...",
+		"..#..#...#..",
+		"..#....#.#..",
+		"..#....#.#..",
+		"..#..#...#..",
+		"...#....#...",
+		"....########",
+		"..#.########",
+		"..#.########",
+		"....########",
+		"....########",
+		"....########",
+		0
+	};
+	static const char *inv[] = {
+		"....########",
+		"....########",
+		"....########",
+		"........####",
+		"...#....#...",
+		"..#..#...#..",
+		"..#....#.#..",
+		"..#....#.#..",
+		"..#..#...#..",
+		"...#....#...",
+		"........####",
+		"..#..#.##.##",
+		"..#.#####.##",
+		"....########",
+		"....########",
+		"....########",
+		0
+	};
+	static const char *copy[] = {
+		"....########",
+		"....########",
+		"....########",
+		"....####..##",
+		"...#....#...",
+		"..#..#...#..",
+		"..#....#.#..",
+		"..#....#.#..",
+		"..#..#...#..",
+		"...#....#...",
+		"....####..##",
+		"..#.#.#..###",
+		"..#......###",
+		"....########",
+		"....########",
+		"....########",
+		0
+	};
+	static const char **golden[4] = { clr, set, inv, copy };
+	uint mode;
+
+	for (mode = GFX_CLR; mode <= GFX_COPY; mode++)
+	{
+		fb_reset();
+		/* Background : a frame of 2 rectangles */
+		gfx_fill(0, 0, 20, 16, GFX_SET);
+		gfx_fill(0, 4, 20,  6, GFX_CLR);
+		gfx_fill(0, 0,  4, 16, GFX_CLR);
+		gfx_blit(2, 3, icon, 8, 10, mode);
+		/* Background beyond column 11 is not into the golden bitmap */
+		gfx_fill(12, 0, 8, 16, GFX_CLR);
+		TEST_CHECK(match(0, 0, golden[mode]));
+	}
+}
+
+/* Drawing partly outside of the display */
+static void test_clip(void)
+{
+	static const char *top[] = {
+		".###....",
+		"#.##....",
+		"##.#....",
+		"..##....",
+		"##..#...",
+		"#..#.#..",
+		"...#..#.",
+		"........",
+		0
+	};
+	static const char *bottom[] = {
+		"........",
+		"......##",
+		"......#.",
+		"....####",
+		"...#..#.",
+		"..#..###",
+		"..#.###.",
+		"..#.###.",
+		"..#.#.##",
+		"...#####",
+		0
+	};
+
+	fb_reset();
+	gfx_fill(-3, -2, 6, 5, GFX_SET);
+	gfx_blit(-4, -3, icon, 8, 10, GFX_SET);
+	gfx_line(-5, -5, 6, 6, GFX_INV);
+	TEST_CHECK(match(0, 0, top));
+
+	fb_reset();
+	gfx_fill(124, 60, 10, 10, GFX_SET);
+	gfx_blit(122, 57, icon, 8, 10, GFX_INV);
+	gfx_rect(126, 55, 5, 5, GFX_SET);
+	gfx_pixel(128, 63, GFX_SET);
+	gfx_pixel(127, 64, GFX_SET);
+	TEST_CHECK(match(120, 54, bottom));
+
+	/* Fully outside */
+	fb_reset();
+	gfx_fill(-10, 10, 10, 5, GFX_SET);
+	gfx_fill(10, 64, 5, 5, GFX_SET);
+	gfx_blit(128, 0, icon, 8, 10, GFX_SET);
+	gfx_blit(0, -10, icon, 8, 10, GFX_SET);
+	gfx_line(-1, 70, 140, 70, GFX_SET);
+	TEST_CHECK(match(0, 0, (const char *[]){ "", 0 }));
+}
+
+int main(void)
+{
+	test_pixel();
+	test_lines();
+	test_line();
+	test_rect();
+	test_fill();
+	test_blit();
+	test_clip();
+
+	return(test_end("gfx"));
+}
+/* EOF */
@@ -0,0 +1,613 @@
+/**
+ * @file  test_link.c
+ * @brief Host test of the link framing (COBS, CRC, error counters)
+ *
+ * Frames are built by an independent (straightforward) encoder of the format
+ * described into link.h, then given to link_feed(). The replies sent by the
+ * link are captured from uart_write() and decoded the same way.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "link.c"
+#include "test.h"
+
+#define FUZZ_FRAMES  20000
+#define BENCH_FRAMES 50000
+
+/* Largest encoded frame used by tests (oversize ones included) */
+#define FRAME_MAX 2048
+
+static u8   wire[FRAME_MAX * 4]; /* Bytes sent by the link (replies) */
+static uint wire_len;
+static uint wire_count;          /* Total number of sent bytes       */
+static u8   seq;                 /* Sequence number of next frame    */
+static u32  baud;                /* Rate set by uart_set_baud()      */
+static uint baud_count;          /* Number of uart_set_baud() calls  */
+static char con[64];             /* Text written to the console      */
+static uint con_len;
+static uint con_count;           /* Number of con_init() calls       */
+static int  scroll;              /* Last disp_scroll() line (or -1)  */
+static u8   ring[64];            /* UART receive buffer              */
+static uint ring_head, ring_tail;
+static int  span_max;            /* Largest span given to link_poll  */
+
+/* -------------------------------------------------------------------------- */
+/* --                               Stubs                                  -- */
+/* -------------------------------------------------------------------------- */
+
+void uart_write(u32 port, const u8 *data, int len)
+{
+	(void)port;
+	wire_count += len;
+	if ((wire_len + len) > sizeof(wire))
+		return;
+	memcpy(&wire[wire_len], data, len);
+	wire_len += len;
+}
+
+/* Same spans as the UART driver : contiguous bytes, up to the ring end */
+int uart_rx_span(u32 port, const u8 **data, int len)
+{
+	int n;
+
+	(void)port;
+	if (ring_head >= ring_tail)
+		n = ring_head - ring_tail;
+	else
+		n = sizeof(ring) - ring_tail;
+	if (n > len)
+		n = len;
+	if (n > span_max)
+		span_max = n;
+	*data = &ring[ring_tail];
+	return(n);
+}
+
+void uart_rx_release(u32 port, int len)
+{
+	(void)port;
+	ring_tail = (ring_tail + len) % sizeof(ring);
+}
+
+void uart_rx_hook(u32 port, void (*hook)(void))
+{
+	(void)port; (void)hook;
+}
+
+/* Rates above 3 Mbauds can not be reached */
+u32 uart_baud_check(u32 rate, int *err)
+{
+	(void)err;
+	return((rate <= 3000000) ? rate : 0);
+}
+
+u32 uart_set_baud(u32 port, u32 rate, int *err)
+{
+	(void)port;
+	baud = rate;
+	baud_count++;
+	return(uart_baud_check(rate, err));
+}
+
+static u8 fb[DISP_PAGES][DISP_WIDTH];
+
+void disp_clear(unsigned char lines)             { (void)lines; }
+int  disp_delta(const u8 *data, uint len)        { (void)data; (void)len; return(0); }
+int  disp_flush_async(void (*done)(void))        { (void)done; return(0); }
+u8  *disp_fb(uint page)                          { return(fb[page]); }
+void disp_mark(uint page, uint x0, uint x1)      { (void)page; (void)x0; (void)x1; }
+void disp_pos(uint x, uint y)                    { (void)x; (void)y; }
+void disp_putc(char c)                           { (void)c; }
+void disp_scroll(uint line)                      { scroll = line; }
+
+void con_init(void)
+{
+	con_count++;
+	con_len = 0;
+}
+
+void con_putc(char c)
+{
+	if (con_len < sizeof(con))
+		con[con_len++] = c;
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                          Frame encoding                              -- */
+/* -------------------------------------------------------------------------- */
+
+/* CRC16-CCITT, bit by bit (not the nibble table of link.c) */
+static u16 crc16(const u8 *data, uint len)
+{
+	u16  crc = 0xFFFF;
+	uint i, b;
+
+	for (i = 0; i < len; i++)
+	{
+		crc ^= (data[i] << 8);
+		for (b = 0; b < 8; b++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+	}
+	return(crc);
+}
+
+/* COBS encoding, followed by the delimiter */
+static uint cobs_encode(u8 *out, const u8 *in, uint len)
+{
+	uint code = 0;
+	uint pos  = 1;
+	uint i;
+
+	for (i = 0; i < len; i++)
+	{
+		if (in[i] == 0x00)
+		{
+			out[code] = (pos - code);
+			code = pos++;
+			continue;
+		}
+		out[pos++] = in[i];
+		if ((pos - code) == 0xFF)
+		{
+			out[code] = 0xFF;
+			code = pos++;
+		}
+	}
+	out[code] = (pos - code);
+	out[pos++] = 0x00;
+	return(pos);
+}
+
+/* COBS decoding of one frame (without delimiter), -1 if malformed */
+static int cobs_decode(u8 *out, const u8 *in, uint len)
+{
+	uint pos = 0;
+	uint i   = 0;
+	uint code, k;
+
+	while (i < len)
+	{
+		code = in[i++];
+		if ((code == 0) || ((i + code - 1) > len))
+			return(-1);
+		for (k = 1; k < code; k++)
+			out[pos++] = in[i++];
+		if ((code != 0xFF) && (i < len))
+			out[pos++] = 0x00;
+	}
+	return(pos);
+}
+
+/**
+ * @brief Build an encoded frame
+ *
+ * @param out  Buffer for the encoded frame (with delimiter)
+ * @param type Type of the message
+ * @param data Payload (any length, to test oversize frames)
+ * @param len  Length of the payload
+ * @param bad  Set to corrupt the CRC
+ * @return integer Length of the encoded frame
+ */
+static uint frame(u8 *out, u8 type, const u8 *data, uint len, int bad)
+{
+	static u8 raw[FRAME_MAX];
+	u16 crc;
+
+	raw[0] = type;
+	raw[1] = seq++;
+	memcpy(&raw[2], data, len);
+	crc = crc16(raw, len + 2);
+	if (bad)
+		crc ^= 0x0001;
+	raw[len + 2] = (crc >> 8);
+	raw[len + 3] = (crc & 0xFF);
+	return(cobs_encode(out, raw, len + 4));
+}
+
+/* Random payload, with some zeros to exercise COBS blocks */
+static void payload(u8 *data, uint len)
+{
+	uint i;
+
+	for (i = 0; i < len; i++)
+		data[i] = (rand() % 4) ? (u8)rand() : 0x00;
+}
+
+/**
+ * @brief Check that the wire contains exactly one valid reply
+ *
+ * @param type Expected type of the reply
+ * @param data Expected payload
+ * @param len  Expected payload length
+ * @return integer Non-zero if the reply is valid
+ */
+static int reply_ok(u8 type, const u8 *data, uint len)
+{
+	static u8 raw[FRAME_MAX];
+	int n;
+
+	if ((wire_len < 2) || (wire[wire_len - 1] != 0x00) ||
+	    memchr(wire, 0x00, wire_len - 1))
+		return(0);
+	n = cobs_decode(raw, wire, wire_len - 1);
+	if (n != (int)(len + 4))
+		return(0);
+	if ((raw[0] != type) || (crc16(raw, n) != 0))
+		return(0);
+	return(memcmp(&raw[2], data, len) == 0);
+}
+
+static int pong_ok(const u8 *data, uint len)
+{
+	return(reply_ok(LINK_PONG, data, len));
+}
+
+/* -------------------------------------------------------------------------- */
+/* --                               Tests                                  -- */
+/* -------------------------------------------------------------------------- */
+
+static void test_ping(void)
+{
+	struct link_stats s = *link_stats();
+	u8   enc[FRAME_MAX], data[LINK_MTU];
+	uint len, n;
+
+	/* All lengths, up to LINK_MTU (frames with more than 254 bytes) */
+	for (len = 0; len <= LINK_MTU; len++)
+	{
+		payload(data, len);
+		n = frame(enc, LINK_PING, data, len, 0);
+		wire_len = 0;
+		link_feed(enc, n);
+		TEST_CHECK(pong_ok(data, len));
+	}
+	TEST_CHECK(link_stats()->rx_frames == s.rx_frames + LINK_MTU + 1);
+	TEST_CHECK(link_stats()->tx_frames == s.tx_frames + LINK_MTU + 1);
+	TEST_CHECK(link_stats()->rx_lost   == s.rx_lost);
+
+	/* Byte by byte, as received from the UART with a slow poll */
+	payload(data, 40);
+	n = frame(enc, LINK_PING, data, 40, 0);
+	wire_len = 0;
+	for (len = 0; len < n; len++)
+		link_feed(&enc[len], 1);
+	TEST_CHECK(pong_ok(data, 40));
+
+	/* Consecutive delimiters are ignored */
+	s = *link_stats();
+	enc[0] = enc[1] = 0x00;
+	link_feed(enc, 2);
+	TEST_CHECK(memcmp(&s, link_stats(), sizeof(s)) == 0);
+
+	/* Payload longer than MTU can not be sent */
+	TEST_CHECK(link_send(LINK_PONG, data, LINK_MTU + 1) == -1);
+}
+
+static void test_poll(void)
+{
+	u8   enc[FRAME_MAX], data[40];
+	uint i, n;
+
+	/* A frame received across the end of the UART ring is decoded in
+	 * place, from two spans, and all its bytes are released */
+	payload(data, sizeof(data));
+	n = frame(enc, LINK_PING, data, sizeof(data), 0);
+	ring_head = ring_tail = sizeof(ring) - 10;
+	for (i = 0; i < n; i++)
+	{
+		ring[ring_head] = enc[i];
+		ring_head = (ring_head + 1) % sizeof(ring);
+	}
+	wire_len = 0;
+	span_max = 0;
+	link_poll();
+	TEST_CHECK(pong_ok(data, sizeof(data)));
+	TEST_CHECK(ring_tail == ring_head);
+	TEST_CHECK((span_max > 0) && (span_max <= 32));
+
+	/* Nothing received, nothing sent */
+	wire_len = 0;
+	link_poll();
+	TEST_CHECK(wire_len == 0);
+}
+
+static void test_crc(void)
+{
+	struct link_stats s = *link_stats();
+	u8   enc[FRAME_MAX], data[LINK_MTU];
+	uint n;
+
+	payload(data, 16);
+	n = frame(enc, LINK_PING, data, 16, 1);
+	wire_len = 0;
+	link_feed(enc, n);
+	TEST_CHECK(wire_len == 0);
+	TEST_CHECK(link_stats()->rx_crc    == s.rx_crc + 1);
+	TEST_CHECK(link_stats()->rx_frames == s.rx_frames);
+
+	/* Error into the content (a code byte of COBS is a framing error) */
+	memset(data, 0x5A, 16);
+	n = frame(enc, LINK_PING, data, 16, 0);
+	enc[n - 8] ^= 0x10;
+	link_feed(enc, n);
+	TEST_CHECK(wire_len == 0);
+	TEST_CHECK(link_stats()->rx_crc == s.rx_crc + 2);
+
+	/* Next frame is accepted, the lost ones are counted */
+	n = frame(enc, LINK_PING, data, 16, 0);
+	link_feed(enc, n);
+	TEST_CHECK(pong_ok(data, 16));
+	TEST_CHECK(link_stats()->rx_lost == s.rx_lost + 2);
+}
+
+static void test_truncated(void)
+{
+	struct link_stats s;
+	u8   enc[FRAME_MAX], data[LINK_MTU];
+	uint n, cut;
+
+	payload(data, LINK_MTU);
+	data[100] = 0x00;
+
+	/* Frame interrupted at any position, then a delimiter */
+	n = frame(enc, LINK_PING, data, LINK_MTU, 0);
+	for (cut = 1; cut < (n - 1); cut++)
+	{
+		s = *link_stats();
+		wire_len = 0;
+		link_feed(enc, cut);
+		link_feed((const u8 *)"", 1);
+		TEST_CHECK(wire_len == 0);
+		TEST_CHECK(link_stats()->rx_frames == s.rx_frames);
+		TEST_CHECK((link_stats()->rx_error + link_stats()->rx_crc) ==
+		           (s.rx_error + s.rx_crc + 1));
+	}
+
+	/* Frames shorter than header and CRC */
+	s = *link_stats();
+	n = cobs_encode(enc, (const u8 *)"\x01\x02\x03", 3);
+	link_feed(enc, n);
+	TEST_CHECK(link_stats()->rx_error == s.rx_error + 1);
+
+	/* Start of a frame lost : the remaining part is merged with the next
+	 * frame, which is dropped too. Parser is synchronized again after. */
+	s = *link_stats();
+	n = frame(enc, LINK_PING, data, 20, 0);
+	link_feed(&enc[n / 2], n - (n / 2));
+	wire_len = 0;
+	n = frame(enc, LINK_PING, data, 20, 0);
+	link_feed(enc, n / 2);
+	n = frame(enc, LINK_PING, data, 20, 0);
+	link_feed(enc, n);
+	TEST_CHECK(wire_len == 0);
+	n = frame(enc, LINK_PING, data, 20, 0);
+	link_feed(enc, n);
+	TEST_CHECK(pong_ok(data, 20));
+	TEST_CHECK(link_stats()->rx_frames == s.rx_frames + 1);
+}
+
+static void test_oversize(void)
+{
+	struct link_stats s = *link_stats();
+	u8   enc[FRAME_MAX], data[FRAME_MAX];
+	uint n;
+
+	/* Largest valid frame */
+	payload(data, LINK_MTU);
+	n = frame(enc, LINK_PING, data, LINK_MTU, 0);
+	wire_len = 0;
+	link_feed(enc, n);
+	TEST_CHECK(pong_ok(data, LINK_MTU));
+
+	/* One byte more, and much more (longer than the receive buffer) */
+	payload(data, sizeof(data) - 16);
+	n = frame(enc, LINK_PING, data, LINK_MTU + 1, 0);
+	wire_len = 0;
+	link_feed(enc, n);
+	n = frame(enc, LINK_PING, data, sizeof(data) - 16, 0);
+	link_feed(enc, n);
+	/* Without any zero into payload (only 0xFF code bytes) */
+	memset(data, 0x55, sizeof(data));
+	n = frame(enc, LINK_PING, data, sizeof(data) - 16, 0);
+	link_feed(enc, n);
+	TEST_CHECK(wire_len == 0);
+	TEST_CHECK(link_stats()->rx_error  == s.rx_error + 3);
+	TEST_CHECK(link_stats()->rx_frames == s.rx_frames + 1);
+
+	/* Next frame is accepted */
+	n = frame(enc, LINK_PING, data, 8, 0);
+	link_feed(enc, n);
+	TEST_CHECK(pong_ok(data, 8));
+}
+
+static void test_baud(void)
+{
+	u8   enc[FRAME_MAX], ack[2];
+	uint n;
+
+	/* Accepted rate : one ACK (success), then the port is switched */
+	ack[0] = seq;
+	ack[1] = 0;
+	n = frame(enc, LINK_BAUD, (const u8 *)"\x00\x10\x0E\x00", 4, 0);
+	wire_len   = 0;
+	baud_count = 0;
+	link_feed(enc, n);
+	TEST_CHECK(reply_ok(LINK_ACK, ack, 2));
+	TEST_CHECK((baud_count == 1) && (baud == 921600));
+
+	/* Refused rate : one ACK (error), port is not modified */
+	ack[0] = seq;
+	ack[1] = 1;
+	n = frame(enc, LINK_BAUD, (const u8 *)"\x00\x09\x3D\x00", 4, 0);
+	wire_len   = 0;
+	baud_count = 0;
+	link_feed(enc, n);
+	TEST_CHECK(reply_ok(LINK_ACK, ack, 2));
+	TEST_CHECK(baud_count == 0);
+
+	/* Malformed request : no ACK, no change */
+	n = frame(enc, LINK_BAUD, (const u8 *)"\x00\x10\x0E", 3, 0);
+	wire_len = 0;
+	link_feed(enc, n);
+	TEST_CHECK((wire_len == 0) && (baud_count == 0));
+}
+
+static void test_console(void)
+{
+	u8   enc[FRAME_MAX];
+	uint n;
+
+	/* First text : console is started, then each char is written */
+	n = frame(enc, LINK_LINE, (const u8 *)"Hello\n", 6, 0);
+	link_feed(enc, n);
+	n = frame(enc, LINK_LINE, (const u8 *)"World", 5, 0);
+	link_feed(enc, n);
+	TEST_CHECK(con_count == 1);
+	TEST_CHECK((con_len == 11) && (memcmp(con, "Hello\nWorld", 11) == 0));
+
+	/* Clear : back to a display without scroll */
+	scroll = -1;
+	n = frame(enc, LINK_CLEAR, (const u8 *)"\xFF", 1, 0);
+	link_feed(enc, n);
+	TEST_CHECK(scroll == 0);
+
+	/* Next text starts a new console */
+	n = frame(enc, LINK_LINE, (const u8 *)"Again", 5, 0);
+	link_feed(enc, n);
+	TEST_CHECK((con_count == 2) && (con_len == 5));
+
+	/* Clear without console : start line is not modified */
+	n = frame(enc, LINK_CLEAR, (const u8 *)"\xFF", 1, 0);
+	link_feed(enc, n);
+	scroll = -1;
+	n = frame(enc, LINK_CLEAR, (const u8 *)"\xFF", 1, 0);
+	link_feed(enc, n);
+	TEST_CHECK(scroll == -1);
+}
+
+/**
+ * @brief Random frames with random errors
+ *
+ * Errors never add a delimiter, so each frame gives exactly one result :
+ * accepted, or dropped and counted. Valid frames must always be answered.
+ */
+static void test_fuzz(void)
+{
+	struct link_stats s = *link_stats();
+	u8   enc[FRAME_MAX], data[LINK_MTU];
+	uint i, n, len, pos, bad, drops;
+
+	drops = 0;
+	for (i = 0; i < FUZZ_FRAMES; i++)
+	{
+		len = rand() % (LINK_MTU + 1);
+		payload(data, len);
+		n = frame(enc, LINK_PING, data, len, 0);
+		bad = rand() % 4;
+		pos = rand() % (n - 1);
+		if (bad == 1)
+			/* Modify one byte */
+			enc[pos] = (enc[pos] ^ (1 + rand() % 255)) ? : 0x01;
+		else if (bad == 2)
+		{
+			/* Remove one byte */
+			memmove(&enc[pos], &enc[pos + 1], n - pos - 1);
+			n--;
+		}
+		else if (bad == 3)
+		{
+			/* Insert one byte */
+			memmove(&enc[pos + 1], &enc[pos], n - pos);
+			enc[pos] = 1 + rand() % 255;
+			n++;
+		}
+		wire_len = 0;
+		link_feed(enc, n);
+		if (bad == 0)
+			TEST_CHECK(pong_ok(data, len));
+		else if (wire_len == 0)
+			drops++;
+	}
+	TEST_CHECK(link_stats()->rx_frames + link_stats()->rx_crc +
+	           link_stats()->rx_error ==
+	           s.rx_frames + s.rx_crc + s.rx_error + FUZZ_FRAMES);
+	TEST_CHECK(link_stats()->rx_crc + link_stats()->rx_error ==
+	           s.rx_crc + s.rx_error + drops);
+
+	/* Random noise (with delimiters), then a valid frame */
+	for (i = 0; i < sizeof(enc); i++)
+		enc[i] = (rand() % 16) ? (u8)rand() : 0x00;
+	link_feed(enc, sizeof(enc));
+	payload(data, 32);
+	n = frame(enc, LINK_PING, data, 32, 0);
+	wire_len = 0;
+	link_feed((const u8 *)"", 1);
+	link_feed(enc, n);
+	TEST_CHECK(pong_ok(data, 32));
+}
+
+/**
+ * @brief Decoding throughput, with frames of LINK_MTU bytes
+ *
+ * Only the time of the host is measured, this is useful to compare two
+ * versions of the parser (not the speed on the target).
+ */
+static void test_speed(void)
+{
+	static u8 stream[BENCH_FRAMES / 10 * (LINK_MTU + 8)];
+	struct link_stats s = *link_stats();
+	u8      data[LINK_MTU];
+	uint    i, n, len;
+	clock_t t;
+	double  sec;
+
+	len = 0;
+	for (i = 0; i < BENCH_FRAMES / 10; i++)
+	{
+		payload(data, LINK_MTU);
+		len += frame(&stream[len], LINK_PING, data, LINK_MTU, 0);
+	}
+	wire_count = 0;
+	t = clock();
+	for (n = 0; n < 10; n++)
+		link_feed(stream, len);
+	sec = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+	TEST_CHECK(link_stats()->rx_frames == s.rx_frames + BENCH_FRAMES);
+	TEST_CHECK(wire_count >= (uint)BENCH_FRAMES * (LINK_MTU + 5));
+	if (sec > 0)
+		printf("  link_feed: %u frames, %.1f MB/s, %.0f frames/s\n",
+		       BENCH_FRAMES, (double)len * 10 / sec / 1e6,
+		       BENCH_FRAMES / sec);
+}
+
+int main(void)
+{
+	srand(1);
+	link_init(0);
+
+	test_ping();
+	test_poll();
+	test_crc();
+	test_truncated();
+	test_oversize();
+	test_baud();
+	test_console();
+	test_fuzz();
+	test_speed();
+
+	return(test_end("link"));
+}
+/* EOF */
@@ -0,0 +1,150 @@
+/**
+ * @file  test_spi.h
+ * @brief Simulated display port (SPI and DMA) for host tests
+ *
+ * Include this after display.c. When the DMA channel is enabled, the linked
+ * descriptors are read to get the bytes sent to the display, then the end of
+ * transfer interrupts are called. Each byte is counted as a command or as a
+ * data byte, depending on the D/C pin level.
+ *
+ * @author Saint-Genest Gwenael <gwen@cowlab.fr>
+ * @copyright Agilack (c) 2022
+ *
+ * @page License
+ * Cowdin-3C-ui firmware is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * version 3 as published by the Free Software Foundation. You should
+ * have received a copy of the GNU Lesser General Public License along
+ * with this program, see LICENSE.md file for more details.
+ * This program is distributed WITHOUT ANY WARRANTY.
+ */
+#ifndef TEST_SPI_H
+#define TEST_SPI_H
+#include <stdint.h>
+
+/* Bytes received by the display since last spi_reset() */
+static struct
+{
+	uint ncmd;
+	uint ndata;
+	u8   cmd[256];
+	u8   data[DISP_PAGES * DISP_WIDTH];
+	uint dc;      /* Current level of D/C pin                 */
+	uint cs;      /* Current level of CS pin                  */
+	uint outside; /* Bytes sent while CS is not active (low)  */
+	uint flush;   /* Number of completed transactions         */
+} spi;
+
+/* Number of DMA transfers to check while a flush is in progress */
+static uint dma_check;
+
+
+int fmt_vprint(void (*out)(char c), const char *fmt, va_list ap)
+{
+	(void)out; (void)fmt; (void)ap;
+	return(0);
+}
+
+void timer_delay_us(u32 us)
+{
+	(void)us;
+}
+
+/* Count one byte received by the display */
+static void spi_byte(u8 v)
+{
+	if (spi.cs)
+		spi.outside++;
+	if (spi.dc == DISP_MODE_CMD)
+	{
+		if (spi.ncmd < sizeof(spi.cmd))
+			spi.cmd[spi.ncmd] = v;
+		spi.ncmd++;
+	}
+	else
+	{
+		if (spi.ndata < sizeof(spi.data))
+			spi.data[spi.ndata] = v;
+		spi.ndata++;
+	}
+}
+
+/**
+ * @brief Receive the bytes of the DMA transfer configured into descriptors
+ *
+ * The whole transfer is done at once, then the interrupt handlers are called
+ * as the hardware would do (the next transfer is started from there).
+ */
+static void dma_run(void)
+{
+	const struct dma_desc *desc = &dma_desc[DMA_DISP];
+	const u8 *buf;
+	uint i;
+
+	while (desc)
+	{
+		TEST_CHECK(desc->btctrl & 1);
+		buf = (const u8 *)(uintptr_t)(desc->srcaddr - desc->btcnt);
+		for (i = 0; i < desc->btcnt; i++)
+			spi_byte(buf[i]);
+		desc = (const struct dma_desc *)(uintptr_t)desc->descaddr;
+	}
+
+	/* Flush in progress : no other flush can be started */
+	if (dma_check)
+	{
+		dma_check--;
+		TEST_CHECK(disp_busy());
+		TEST_CHECK(disp_flush_async(0) == -1);
+	}
+	DMAC_Handler();
+	SERCOM0_Handler();
+}
+
+u32 hw_rd(u32 reg, uint size)
+{
+	(void)size;
+	if (reg == (SPI_DISP + 0x18))  /* INTFLAG : DRE and TXC */
+		return(0x03);
+	if (reg == (DMAC_ADDR + 0x4E)) /* CHINTFLAG : TCMPL */
+		return(0x02);
+	return(0);
+}
+
+void hw_wr(u32 reg, u32 value, uint size)
+{
+	(void)size;
+	if (reg == (GPIO_ADDR + 0x18)) /* OUTSET */
+	{
+		if (value & GPIO(PIN_DISP_DC))
+			spi.dc = DISP_MODE_DATA;
+		if (value & GPIO(PIN_DISP_NSS))
+		{
+			spi.cs = 1;
+			spi.flush++;
+		}
+	}
+	if (reg == (GPIO_ADDR + 0x14)) /* OUTCLR */
+	{
+		if (value & GPIO(PIN_DISP_DC))
+			spi.dc = DISP_MODE_CMD;
+		if (value & GPIO(PIN_DISP_NSS))
+			spi.cs = 0;
+	}
+	if (reg == (SPI_DISP + 0x28))  /* DATA */
+		spi_byte(value);
+	/* CHCTRLA : channel enabled */
+	if ((reg == (DMAC_ADDR + 0x40)) && (value == 0x02))
+		dma_run();
+}
+
+/* Forget the bytes received by the display */
+static void spi_reset(void)
+{
+	spi.ncmd  = 0;
+	spi.ndata = 0;
+	spi.flush = 0;
+}
+
+#endif
+/* EOF */